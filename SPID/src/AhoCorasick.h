@@ -0,0 +1,175 @@
+#pragma once
+
+#include "CaseFold.h"
+
+/// AhoCorasick is a case-insensitive multi-pattern string matcher.
+///
+/// It finds all occurrences of any number of patterns in a single pass over the text,
+/// so the cost of matching doesn't depend on the number of patterns.
+/// <p>
+///	<b>Note: Patterns are compared case-insensitively (ASCII only) and empty patterns never match anything,
+///	which mirrors the behavior of string::icontains.</b>
+///	</p>
+class AhoCorasick
+{
+public:
+	using PatternIndex = std::uint32_t;
+
+	AhoCorasick() = default;
+
+	/// Builds an automaton for given patterns.
+	///	Each pattern is reported by its index in the given vector.
+	template <typename Strings>
+	explicit AhoCorasick(const Strings& a_patterns)
+	{
+		build(a_patterns);
+	}
+
+	/// Calls a_callback with index of every pattern that occurs in a_text.
+	///	The same pattern is reported once for each of its occurrences.
+	template <typename Callback>
+	void ForEachMatch(std::string_view a_text, Callback&& a_callback) const
+	{
+		if (transitions.empty()) {
+			return;
+		}
+
+		State state = root;
+		for (const auto ch : a_text) {
+			state = transitions[state * classCount + classes[static_cast<std::uint8_t>(ch)]];
+			for (auto i = outputOffsets[state]; i < outputOffsets[state + 1]; ++i) {
+				a_callback(outputs[i]);
+			}
+		}
+	}
+
+	/// Checks whether any of the patterns occurs in a_text.
+	[[nodiscard]] bool Contains(std::string_view a_text) const
+	{
+		if (transitions.empty()) {
+			return false;
+		}
+
+		State state = root;
+		for (const auto ch : a_text) {
+			state = transitions[state * classCount + classes[static_cast<std::uint8_t>(ch)]];
+			if (outputOffsets[state] != outputOffsets[state + 1]) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	[[nodiscard]] bool empty() const { return transitions.empty(); }
+
+	/// Number of states in the automaton.
+	[[nodiscard]] std::size_t size() const { return outputOffsets.empty() ? 0 : outputOffsets.size() - 1; }
+
+private:
+	using State = std::uint32_t;
+
+	static constexpr State root = 0;
+	static constexpr State none = std::numeric_limits<State>::max();
+
+	/// Maps each byte to a character class.
+	///	Only characters that occur in patterns get their own classes (shared by both cases of a letter),
+	///	all other characters fall into class 0, which always leads back to the root.
+	///	This keeps transitions table small enough to be dense.
+	std::array<std::uint8_t, 256> classes{};
+	std::size_t                   classCount{ 1 };
+
+	/// Dense table of transitions indexed with [state * classCount + class].
+	///	Failure links are already folded into it, so matching takes exactly one lookup per character.
+	std::vector<State> transitions{};
+
+	/// Indices of patterns that end at each state, including those reachable through failure links.
+	///	Outputs of a state are stored at [outputOffsets[state], outputOffsets[state + 1]).
+	std::vector<std::uint32_t> outputOffsets{};
+	std::vector<PatternIndex>  outputs{};
+
+	template <typename Strings>
+	void build(const Strings& a_patterns)
+	{
+		for (const auto& pattern : a_patterns) {
+			for (const auto ch : pattern) {
+				const auto lower = static_cast<std::uint8_t>(CaseFold::fold(ch));
+				if (classes[lower] == 0) {
+					// Folding leaves less than 256 distinct characters, so classes always fit into a byte.
+					const auto cls = static_cast<std::uint8_t>(classCount++);
+					classes[lower] = cls;
+					classes[static_cast<std::uint8_t>(std::toupper(lower))] = cls;
+				}
+			}
+		}
+
+		// Build a trie of all patterns.
+		std::vector<std::vector<PatternIndex>> ownOutputs(1);
+		transitions.assign(classCount, none);
+
+		PatternIndex index = 0;
+		for (const auto& pattern : a_patterns) {
+			if (std::string_view(pattern).empty()) {
+				++index;
+				continue;
+			}
+			State state = root;
+			for (const auto ch : pattern) {
+				auto& next = transitions[state * classCount + classes[static_cast<std::uint8_t>(CaseFold::fold(ch))]];
+				if (next == none) {
+					next = static_cast<State>(ownOutputs.size());
+					ownOutputs.emplace_back();
+					transitions.resize(transitions.size() + classCount, none);
+				}
+				// transitions might have been reallocated, so state is read again by index.
+				state = transitions[state * classCount + classes[static_cast<std::uint8_t>(CaseFold::fold(ch))]];
+			}
+			ownOutputs[state].push_back(index++);
+		}
+
+		if (ownOutputs.size() == 1) {
+			// No non-empty patterns, nothing can ever match.
+			transitions.clear();
+			return;
+		}
+
+		// Breadth-first traversal computes failure links and completes transitions for missing characters.
+		const auto         stateCount = ownOutputs.size();
+		std::vector<State> failure(stateCount, root);
+		std::vector<State> order{};
+		order.reserve(stateCount);
+
+		for (std::size_t cls = 0; cls < classCount; ++cls) {
+			auto& next = transitions[cls];
+			if (next == none || cls == 0) {
+				next = root;
+			} else {
+				order.push_back(next);
+			}
+		}
+
+		for (std::size_t i = 0; i < order.size(); ++i) {
+			const auto state = order[i];
+			// Outputs of failure state are complete by now, since it's closer to the root.
+			auto& own = ownOutputs[state];
+			own.insert(own.end(), ownOutputs[failure[state]].begin(), ownOutputs[failure[state]].end());
+
+			for (std::size_t cls = 0; cls < classCount; ++cls) {
+				auto&      next = transitions[state * classCount + cls];
+				const auto fallback = transitions[failure[state] * classCount + cls];
+				if (next == none) {
+					next = fallback;
+				} else {
+					failure[next] = fallback;
+					order.push_back(next);
+				}
+			}
+		}
+
+		outputOffsets.reserve(stateCount + 1);
+		for (const auto& own : ownOutputs) {
+			outputOffsets.push_back(static_cast<std::uint32_t>(outputs.size()));
+			outputs.insert(outputs.end(), own.begin(), own.end());
+		}
+		outputOffsets.push_back(static_cast<std::uint32_t>(outputs.size()));
+	}
+};
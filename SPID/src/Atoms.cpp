@@ -0,0 +1,107 @@
+#include "Atoms.h"
+
+namespace Atoms
+{
+	Atom Table::Intern(std::string_view a_str)
+	{
+		if (const auto it = atoms.find(a_str); it != atoms.end()) {
+			return it->second;
+		}
+
+		auto folded = CaseFold::folded(a_str);
+
+		const auto atom = static_cast<Atom>(strings.size());
+		atoms.emplace(folded, atom);
+		strings.emplace_back(std::move(folded));
+
+		return atom;
+	}
+
+	std::optional<Atom> Table::Find(std::string_view a_str) const
+	{
+		if (const auto it = atoms.find(a_str); it != atoms.end()) {
+			return it->second;
+		}
+		return std::nullopt;
+	}
+
+	std::optional<Atom> Table::Find(const RE::BGSKeyword* a_keyword) const
+	{
+		if (const auto it = keywords.find(a_keyword); it != keywords.end()) {
+			return it->second;
+		}
+		// Keywords that were created after lookup (e.g. by other plugins) are resolved by their EditorIDs.
+		if (const auto edid = a_keyword->GetFormEditorID(); !string::is_empty(edid)) {
+			return Find(std::string_view(edid));
+		}
+		return std::nullopt;
+	}
+
+	void Table::InternKeywords(RE::TESDataHandler* const a_dataHandler)
+	{
+		const auto& keywordArray = a_dataHandler->GetFormArray<RE::BGSKeyword>();
+
+		keywords.reserve(keywordArray.size());
+
+		for (const auto& keyword : keywordArray) {
+			if (keyword) {
+				if (const auto edid = keyword->GetFormEditorID(); !string::is_empty(edid)) {
+					keywords.emplace(keyword, Intern(edid));
+				}
+			}
+		}
+	}
+
+	const std::string& Table::GetString(Atom a_atom) const
+	{
+		return strings[a_atom];
+	}
+
+	std::size_t Table::GetSize() const
+	{
+		return strings.size();
+	}
+
+	AtomVec Intern(const StringVec& a_strings)
+	{
+		AtomVec result{};
+		result.reserve(a_strings.size());
+		for (const auto& str : a_strings) {
+			result.push_back(Intern(str));
+		}
+		return result;
+	}
+
+	bool Set::insert(Atom a_atom)
+	{
+		const auto it = std::ranges::lower_bound(atoms, a_atom);
+		if (it != atoms.end() && *it == a_atom) {
+			return false;
+		}
+		atoms.insert(it, a_atom);
+		return true;
+	}
+
+	void Set::merge(const Set& a_other)
+	{
+		AtomVec merged{};
+		merged.reserve(atoms.size() + a_other.atoms.size());
+		std::ranges::set_union(atoms, a_other.atoms, std::back_inserter(merged));
+		atoms = std::move(merged);
+	}
+
+	bool Set::contains(Atom a_atom) const
+	{
+		return std::ranges::binary_search(atoms, a_atom);
+	}
+
+	bool Set::contains_all(std::span<const Atom> a_atoms) const
+	{
+		return std::ranges::all_of(a_atoms, [&](const auto atom) { return contains(atom); });
+	}
+
+	bool Set::contains_any(std::span<const Atom> a_atoms) const
+	{
+		return std::ranges::any_of(a_atoms, [&](const auto atom) { return contains(atom); });
+	}
+}
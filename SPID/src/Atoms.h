@@ -0,0 +1,126 @@
+#pragma once
+
+#include "CaseFold.h"
+
+/// Atoms are interned, case-folded strings.
+///
+/// All strings used by String Filters and all keyword EditorIDs are interned during lookup,
+/// so that string filters can be evaluated with simple integer comparisons instead of case-insensitive string comparisons.
+/// Two strings are represented by the same Atom if and only if they are equal when compared case-insensitively.
+namespace Atoms
+{
+	using Atom = std::uint32_t;
+	using AtomVec = std::vector<Atom>;
+
+	namespace detail
+	{
+		struct ifold_hash
+		{
+			using is_transparent = void;  // enable heterogeneous overloads
+
+			[[nodiscard]] std::uint64_t operator()(std::string_view a_str) const noexcept
+			{
+				// FNV-1a over case-folded characters. Not avalanching, so unordered_dense will mix it on its own.
+				std::uint64_t hash = 14695981039346656037ull;
+				for (const auto ch : a_str) {
+					hash ^= static_cast<std::uint8_t>(CaseFold::fold(ch));
+					hash *= 1099511628211ull;
+				}
+				return hash;
+			}
+		};
+
+		struct ifold_equal
+		{
+			using is_transparent = void;  // enable heterogeneous overloads
+
+			[[nodiscard]] bool operator()(std::string_view a_lhs, std::string_view a_rhs) const noexcept
+			{
+				return CaseFold::iequals(a_lhs, a_rhs);
+			}
+		};
+	}
+
+	/// <summary>
+	/// A table that assigns a unique Atom to each case-insensitively distinct string.
+	///
+	/// The table is populated during lookup and is treated as read-only afterwards,
+	/// so it doesn't synchronize access to itself.
+	/// </summary>
+	class Table
+	{
+	public:
+		/// Returns an Atom for the given string, creating a new one if the string wasn't interned yet.
+		Atom Intern(std::string_view a_str);
+
+		/// Returns an Atom for the given string if it was interned before.
+		[[nodiscard]] std::optional<Atom> Find(std::string_view a_str) const;
+
+		/// Returns an Atom for the given keyword.
+		/// Keywords that were interned with InternKeywords are resolved without hashing their EditorIDs.
+		[[nodiscard]] std::optional<Atom> Find(const RE::BGSKeyword* a_keyword) const;
+
+		/// Interns EditorIDs of all keywords that are currently registered in the data handler.
+		void InternKeywords(RE::TESDataHandler* const);
+
+		/// Returns case-folded string that is represented by the Atom.
+		[[nodiscard]] const std::string& GetString(Atom a_atom) const;
+
+		[[nodiscard]] std::size_t GetSize() const;
+
+	private:
+		ankerl::unordered_dense::map<std::string, Atom, detail::ifold_hash, detail::ifold_equal> atoms{};
+		Map<const RE::BGSKeyword*, Atom>                                                       keywords{};
+		std::vector<std::string>                                                               strings{};
+	};
+
+	/// The table that is used by Filters and NPC Data.
+	inline Table table{};
+
+	inline Atom Intern(std::string_view a_str) { return table.Intern(a_str); }
+
+	inline std::optional<Atom> Find(std::string_view a_str) { return table.Find(a_str); }
+
+	inline std::optional<Atom> Find(const RE::BGSKeyword* a_keyword) { return table.Find(a_keyword); }
+
+	AtomVec Intern(const StringVec& a_strings);
+
+	/// <summary>
+	/// A sorted set of Atoms.
+	///
+	/// Flat storage keeps the whole set in a couple of cache lines for a typical NPC,
+	/// which makes lookups faster than in a node or hash based set.
+	/// </summary>
+	class Set
+	{
+	public:
+		/// Inserts an Atom into the set.
+		/// <returns>True if the atom was not in the set before.</returns>
+		bool insert(Atom a_atom);
+
+		/// Inserts all Atoms of another set.
+		void merge(const Set& a_other);
+
+		[[nodiscard]] bool contains(Atom a_atom) const;
+
+		/// Checks whether the set contains all of the given atoms.
+		[[nodiscard]] bool contains_all(std::span<const Atom> a_atoms) const;
+
+		/// Checks whether the set contains at least one of the given atoms.
+		[[nodiscard]] bool contains_any(std::span<const Atom> a_atoms) const;
+
+		[[nodiscard]] bool        empty() const { return atoms.empty(); }
+		[[nodiscard]] std::size_t size() const { return atoms.size(); }
+
+		[[nodiscard]] AtomVec::const_iterator begin() const { return atoms.begin(); }
+		[[nodiscard]] AtomVec::const_iterator end() const { return atoms.end(); }
+
+		void reserve(std::size_t a_size) { atoms.reserve(a_size); }
+
+	private:
+		AtomVec atoms{};
+	};
+}
+
+using Atom = Atoms::Atom;
+using AtomVec = Atoms::AtomVec;
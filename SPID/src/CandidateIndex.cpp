@@ -0,0 +1,279 @@
+#include "CandidateIndex.h"
+#include "LookupNPC.h"
+
+namespace Candidates
+{
+	namespace detail
+	{
+		enum class KeyType : std::uint32_t
+		{
+			kAtom = 1,
+			kForm,
+			kPlugin
+		};
+
+		Key make_key(KeyType a_type, std::uint32_t a_value)
+		{
+			return (static_cast<Key>(a_type) << 32) | a_value;
+		}
+
+		/// Plugin index that matches the one used by RE::TESFile::IsFormInMod.
+		/// Light plugins are identified by both 0xFE prefix and their small file index.
+		std::uint32_t plugin_index(RE::FormID a_formID)
+		{
+			const auto modIndex = a_formID >> 24;
+			return modIndex == 0xFE ? a_formID >> 12 : modIndex;
+		}
+
+		std::uint32_t plugin_index(const RE::TESFile* a_file)
+		{
+			if (a_file->IsLight()) {
+				return (0xFEu << 12) | a_file->GetSmallFileCompileIndex();
+			}
+			return a_file->GetCompileIndex();
+		}
+
+		/// Returns a bit for each of 64 entries starting at given masks, which is set when (a_traits & care) == want.
+		std::uint64_t match_traits(const std::uint8_t* a_care, const std::uint8_t* a_want, std::uint8_t a_traits)
+		{
+			const auto traits = _mm_set1_epi8(static_cast<char>(a_traits));
+
+			std::uint64_t matched = 0;
+			for (std::size_t i = 0; i < 64; i += 16) {
+				const auto care = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a_care + i));
+				const auto want = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a_want + i));
+				const auto equal = _mm_cmpeq_epi8(_mm_and_si128(traits, care), want);
+				matched |= static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(equal))) << i;
+			}
+			return matched;
+		}
+
+		/// Returns a key for the form filter if NPC::Data::HasFormFilter can be answered with a single lookup.
+		std::optional<Key> form_key(const FormOrMod& a_formOrMod)
+		{
+			if (const auto file = std::get_if<const RE::TESFile*>(&a_formOrMod)) {
+				return make_key(KeyType::kPlugin, plugin_index(*file));
+			}
+
+			const auto form = std::get<RE::TESForm*>(a_formOrMod);
+			switch (form->GetFormType()) {
+			case RE::FormType::Race:
+			case RE::FormType::NPC:
+			case RE::FormType::Faction:
+			case RE::FormType::Class:
+			case RE::FormType::VoiceType:
+			case RE::FormType::CombatStyle:
+				return make_key(KeyType::kForm, form->GetFormID());
+			default:
+				return std::nullopt;
+			}
+		}
+	}
+
+	void Set::reset(std::size_t a_size)
+	{
+		bits.assign((a_size + 63) / 64, 0);
+	}
+
+	void Set::insert(std::size_t a_index)
+	{
+		bits[a_index / 64] |= 1ull << (a_index % 64);
+	}
+
+	std::size_t Set::next(std::size_t a_from) const
+	{
+		auto word = a_from / 64;
+		if (word >= bits.size()) {
+			return npos;
+		}
+
+		// Mask out bits that are before a_from in the first word.
+		auto current = bits[word] & (~0ull << (a_from % 64));
+		while (current == 0) {
+			if (++word >= bits.size()) {
+				return npos;
+			}
+			current = bits[word];
+		}
+
+		return word * 64 + std::countr_zero(current);
+	}
+
+	void Index::Clear()
+	{
+		postings.clear();
+		unconstrained.clear();
+		traitCare.clear();
+		traitWant.clear();
+		hasTraits = false;
+		hasAtomKeys = false;
+		hasFormKeys = false;
+		size = 0;
+		built = false;
+	}
+
+	bool Index::IsValid(std::size_t a_size) const
+	{
+		return built && size == a_size;
+	}
+
+	void Index::insert(std::uint32_t a_index, const FilterData& a_filters)
+	{
+		using namespace detail;
+
+		traitCare.push_back(a_filters.traitMask.care);
+		traitWant.push_back(a_filters.traitMask.want);
+		hasTraits |= a_filters.traitMask.care != NPC::kNone;
+
+		// Any of the requirements is enough to reject NPCs that don't have it,
+		// so the one with the fewest keys is picked to keep posting lists short.
+		std::optional<std::vector<Key>> requirement{};
+
+		const auto consider = [&](std::vector<Key>&& a_keys) {
+			if (!requirement || a_keys.size() < requirement->size()) {
+				requirement = std::move(a_keys);
+			}
+		};
+
+		for (const auto& formOrMod : a_filters.forms.ALL) {
+			if (const auto key = form_key(formOrMod)) {
+				consider({ *key });
+			}
+		}
+
+		if (!a_filters.forms.MATCH.empty()) {
+			std::vector<Key> keys{};
+			for (const auto& formOrMod : a_filters.forms.MATCH) {
+				if (const auto key = form_key(formOrMod)) {
+					keys.push_back(*key);
+				} else {
+					// A single form that can't be looked up makes the whole MATCH filter unusable.
+					keys.clear();
+					break;
+				}
+			}
+			if (!keys.empty()) {
+				consider(std::move(keys));
+			}
+		}
+
+		for (const auto& atom : a_filters.stringAtoms.ALL) {
+			consider({ make_key(KeyType::kAtom, atom) });
+		}
+
+		if (!a_filters.stringAtoms.MATCH.empty()) {
+			std::vector<Key> keys{};
+			for (const auto& atom : a_filters.stringAtoms.MATCH) {
+				keys.push_back(make_key(KeyType::kAtom, atom));
+			}
+			consider(std::move(keys));
+		}
+
+		if (requirement) {
+			for (const auto& key : *requirement) {
+				postings[key].push_back(a_index);
+				if (key >> 32 == static_cast<Key>(KeyType::kAtom)) {
+					hasAtomKeys = true;
+				} else {
+					hasFormKeys = true;
+				}
+			}
+		} else {
+			unconstrained.push_back(a_index);
+		}
+	}
+
+	void Index::finish_traits()
+	{
+		// Padding entries match any NPC, but they are never in the Set anyway.
+		const auto paddedSize = (size + 63) / 64 * 64;
+		traitCare.resize(paddedSize, NPC::kNone);
+		traitWant.resize(paddedSize, NPC::kNone);
+	}
+
+	void Index::retain_traits(std::uint8_t a_traits, Set& a_candidates) const
+	{
+		for (std::size_t word = 0; word < a_candidates.bits.size(); ++word) {
+			if (auto& bits = a_candidates.bits[word]) {
+				bits &= detail::match_traits(traitCare.data() + word * 64, traitWant.data() + word * 64, a_traits);
+			}
+		}
+	}
+
+	void Index::collect(Key a_key, Set& a_candidates) const
+	{
+		if (const auto it = postings.find(a_key); it != postings.end()) {
+			for (const auto index : it->second) {
+				a_candidates.insert(index);
+			}
+		}
+	}
+
+	void Index::Collect(const NPC::Data& a_npcData, Set& a_candidates) const
+	{
+		a_candidates.reset(size);
+
+		for (const auto index : unconstrained) {
+			a_candidates.insert(index);
+		}
+
+		if (!postings.empty()) {
+			collect_keys(a_npcData, a_candidates);
+		}
+
+		if (hasTraits) {
+			retain_traits(a_npcData.GetFeatures().traits, a_candidates);
+		}
+	}
+
+	void Index::collect_keys(const NPC::Data& a_npcData, Set& a_candidates) const
+	{
+		using namespace detail;
+
+		// NPC's strings and IDs are computed lazily, so they are only requested when some key can match them.
+		if (hasAtomKeys) {
+			for (const auto atom : a_npcData.GetStrings()) {
+				collect(make_key(KeyType::kAtom, atom), a_candidates);
+			}
+		}
+
+		if (!hasFormKeys) {
+			return;
+		}
+
+		const auto collect_form = [&](const RE::TESForm* a_form) {
+			if (a_form) {
+				collect(make_key(KeyType::kForm, a_form->GetFormID()), a_candidates);
+			}
+		};
+
+		const auto npc = a_npcData.GetNPC();
+
+		collect_form(npc);
+		collect_form(a_npcData.GetRace());
+		collect_form(npc->npcClass);
+		collect_form(npc->voiceType);
+		collect_form(npc->GetCombatStyle());
+
+		// Factions that were planned for NPC are not added to it until the plan is applied, but filters already see them.
+		for (const auto factionID : a_npcData.GetFactions()) {
+			collect(make_key(KeyType::kForm, factionID), a_candidates);
+		}
+
+		a_npcData.ForEachID([&](RE::FormID a_formID) {
+			collect(make_key(KeyType::kForm, a_formID), a_candidates);
+			collect(make_key(KeyType::kPlugin, plugin_index(a_formID)), a_candidates);
+		});
+	}
+
+	void Index::Collect(const RE::BGSKeyword* a_keyword, Set& a_candidates) const
+	{
+		if (postings.empty()) {
+			return;
+		}
+
+		if (const auto atom = Atoms::Find(a_keyword)) {
+			collect(detail::make_key(detail::KeyType::kAtom, *atom), a_candidates);
+		}
+	}
+}
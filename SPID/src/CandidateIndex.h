@@ -0,0 +1,96 @@
+#pragma once
+
+#include "LookupFilters.h"
+
+namespace NPC
+{
+	struct Data;
+}
+
+/// Candidates are entries of a single DataVec that might pass filters for a given NPC.
+///
+/// Most entries require NPC to have a specific keyword, race, faction, etc. (through ALL or MATCH filters).
+/// Candidate Index maps each of such requirements to entries that have it,
+/// so that NPC only needs to evaluate filters of entries whose requirements it meets, instead of all entries.
+namespace Candidates
+{
+	/// A requirement that can be checked by looking up a single value of NPC.
+	/// Upper 32 bits hold type of the key, lower 32 bits hold the value (Atom, FormID or plugin index).
+	using Key = std::uint64_t;
+
+	/// <summary>
+	/// A set of indices of candidate entries.
+	/// </summary>
+	class Set
+	{
+	public:
+		static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+		/// Clears the set and makes it able to hold indices in [0, a_size).
+		void reset(std::size_t a_size);
+
+		void insert(std::size_t a_index);
+
+		/// Returns the smallest index in the set that is not less than a_from, or npos if there is none.
+		[[nodiscard]] std::size_t next(std::size_t a_from) const;
+
+	private:
+		friend class Index;
+
+		std::vector<std::uint64_t> bits{};
+	};
+
+	/// <summary>
+	/// Inverted index of entries in a single DataVec.
+	///
+	/// Each entry is either posted under keys of one of its requirements (NPC must have at least one of them),
+	/// or is unconstrained, when none of its filters can be expressed with keys.
+	/// Index is built once lookup is finished and is treated as read-only afterwards.
+	/// </summary>
+	class Index
+	{
+	public:
+		template <class DataVec>
+		void Build(const DataVec& a_entries)
+		{
+			Clear();
+			size = a_entries.size();
+			for (std::uint32_t i = 0; i < size; ++i) {
+				insert(i, a_entries[i].filters);
+			}
+			finish_traits();
+			built = true;
+		}
+
+		void Clear();
+
+		/// Whether the index was built for a list of given size and can be used to find candidates in it.
+		/// Lists that were modified after the index was built must be processed without it.
+		[[nodiscard]] bool IsValid(std::size_t a_size) const;
+
+		/// Fills the set with all entries that might match given NPC, including unconstrained ones.
+		/// Entries whose Trait Filters don't match NPC are never included.
+		void Collect(const NPC::Data& a_npcData, Set& a_candidates) const;
+
+		/// Adds entries that require given keyword to the set.
+		/// This is used when NPC receives new keywords in the middle of distribution.
+		void Collect(const RE::BGSKeyword* a_keyword, Set& a_candidates) const;
+
+	private:
+		Map<Key, std::vector<std::uint32_t>> postings{};
+		std::vector<std::uint32_t>           unconstrained{};
+		std::vector<std::uint8_t>            traitCare{};  // TraitMask::care of each entry, padded to whole words of Set.
+		std::vector<std::uint8_t>            traitWant{};  // TraitMask::want of each entry, padded to whole words of Set.
+		bool                                 hasTraits{ false };
+		bool                                 hasAtomKeys{ false };  // Whether NPC's strings are needed to collect candidates.
+		bool                                 hasFormKeys{ false };  // Whether NPC's forms and IDs are needed to collect candidates.
+		std::size_t                          size{ 0 };
+		bool                                 built{ false };
+
+		void insert(std::uint32_t a_index, const FilterData& a_filters);
+		void finish_traits();
+		void collect(Key a_key, Set& a_candidates) const;
+		void collect_keys(const NPC::Data& a_npcData, Set& a_candidates) const;
+		void retain_traits(std::uint8_t a_traits, Set& a_candidates) const;
+	};
+}
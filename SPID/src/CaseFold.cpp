@@ -0,0 +1,76 @@
+#include "CaseFold.h"
+
+namespace CaseFold
+{
+	namespace
+	{
+		constexpr std::size_t width = 16;
+
+		__m128i load(const char* a_ptr)
+		{
+			return _mm_loadu_si128(reinterpret_cast<const __m128i*>(a_ptr));
+		}
+
+		/// Folds 16 characters at once. Bytes above 0x7F are negative as signed chars, so they are never treated as letters.
+		__m128i fold16(__m128i a_chars)
+		{
+			const auto upper = _mm_and_si128(_mm_cmpgt_epi8(a_chars, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(a_chars, _mm_set1_epi8('Z' + 1)));
+			return _mm_or_si128(a_chars, _mm_and_si128(upper, _mm_set1_epi8('a' - 'A')));
+		}
+
+		void fold_into(const char* a_src, char* a_dst, std::size_t a_size)
+		{
+			std::size_t i = 0;
+			for (; i + width <= a_size; i += width) {
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(a_dst + i), fold16(load(a_src + i)));
+			}
+			for (; i < a_size; ++i) {
+				a_dst[i] = fold(a_src[i]);
+			}
+		}
+	}
+
+	namespace detail
+	{
+		bool iequals(const char* a_lhs, const char* a_rhs, std::size_t a_size)
+		{
+			std::size_t i = 0;
+			for (; i + width <= a_size; i += width) {
+				const auto equal = _mm_cmpeq_epi8(fold16(load(a_lhs + i)), fold16(load(a_rhs + i)));
+				if (_mm_movemask_epi8(equal) != 0xFFFF) {
+					return false;
+				}
+			}
+			for (; i < a_size; ++i) {
+				if (table[static_cast<std::uint8_t>(a_lhs[i])] != table[static_cast<std::uint8_t>(a_rhs[i])]) {
+					return false;
+				}
+			}
+			return true;
+		}
+	}
+
+	void fold(std::string& a_str)
+	{
+		fold_into(a_str.data(), a_str.data(), a_str.size());
+	}
+
+	std::string folded(std::string_view a_str)
+	{
+		std::string result{ a_str };
+		fold(result);
+		return result;
+	}
+
+	std::string_view folded(std::string_view a_str, std::span<char> a_buffer)
+	{
+		assert(a_str.size() <= a_buffer.size());
+		fold_into(a_str.data(), a_buffer.data(), a_str.size());
+		return { a_buffer.data(), a_str.size() };
+	}
+
+	bool iequals(std::string_view a_lhs, std::string_view a_rhs)
+	{
+		return a_lhs.size() == a_rhs.size() && detail::iequals(a_lhs.data(), a_rhs.data(), a_lhs.size());
+	}
+}
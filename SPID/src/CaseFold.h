@@ -0,0 +1,43 @@
+#pragma once
+
+/// CaseFold provides ASCII case-insensitive string comparisons.
+///
+/// Strings that are compared repeatedly (EditorIDs, keywords, names) are folded once when they are collected,
+/// so that most comparisons can be exact. The kernels below handle the rest 16 characters at a time.
+/// <p>
+///	<b>Note: Only ASCII letters are folded and all other bytes (including UTF-8 sequences) are compared as is,
+///	which mirrors the behavior of string::iequals.</b>
+///	</p>
+namespace CaseFold
+{
+	namespace detail
+	{
+		constexpr std::array<std::uint8_t, 256> table = [] {
+			std::array<std::uint8_t, 256> result{};
+			for (std::size_t ch = 0; ch < result.size(); ++ch) {
+				result[ch] = static_cast<std::uint8_t>(ch >= 'A' && ch <= 'Z' ? ch + ('a' - 'A') : ch);
+			}
+			return result;
+		}();
+
+		/// Compares a_size characters of both strings case-insensitively.
+		[[nodiscard]] bool iequals(const char* a_lhs, const char* a_rhs, std::size_t a_size);
+	}
+
+	[[nodiscard]] constexpr char fold(char a_ch)
+	{
+		return static_cast<char>(detail::table[static_cast<std::uint8_t>(a_ch)]);
+	}
+
+	/// Folds the string in place.
+	void fold(std::string& a_str);
+
+	/// Returns a folded copy of the string.
+	[[nodiscard]] std::string folded(std::string_view a_str);
+
+	/// Folds the string into a_buffer, which must be at least as large as the string, and returns the folded part of a_buffer.
+	[[nodiscard]] std::string_view folded(std::string_view a_str, std::span<char> a_buffer);
+
+	/// Checks whether two strings are equal case-insensitively.
+	[[nodiscard]] bool iequals(std::string_view a_lhs, std::string_view a_rhs);
+}
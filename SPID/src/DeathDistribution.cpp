@@ -152,6 +152,11 @@ namespace DeathDistribution
 				}
 			});
 		}
+
+		// Build candidate indices of all entries.
+		ForEachDistributable([&]<typename Form>(Distributables<Form>& a_distributable) {
+			a_distributable.FinishLookupForms();
+		});
 	}
 
 	bool Manager::IsEmpty()
@@ -249,8 +254,6 @@ namespace DeathDistribution
 
 		const auto input = PCLevelMult::Input{ data.GetActor(), data.GetNPC(), false };
 
-		DistributedForms distributedForms{};
-
 		Forms::DistributionSet entries{
 			spells.GetForms(),
 			perks.GetForms(),
@@ -265,15 +268,20 @@ namespace DeathDistribution
 			skins.GetForms()
 		};
 
-		Distribute::Distribute(data, input, entries, &distributedForms, Outfits::SetDeathOutfit);
+		Distribute::DistributionPlan plan{};
+
+		Distribute::Plan(data, input, entries, plan);
 
-		if (!distributedForms.empty()) {
-			LinkedDistribution::Manager::GetSingleton()->ForEachLinkedDistributionSet(LinkedDistribution::kDeath, distributedForms, [&](Forms::DistributionSet& set) {
-				Distribute::Distribute(data, input, set, &distributedForms, Outfits::SetDeathOutfit);
+		if (!plan.distributedForms.empty()) {
+			LinkedDistribution::Manager::GetSingleton()->ForEachLinkedDistributionSet(LinkedDistribution::kDeath, plan.distributedForms, [&](Forms::DistributionSet& set) {
+				Distribute::Plan(data, input, set, plan);
 			});
 		}
 
-		Distribute::LogDistribution(distributedForms, data);
+		Distribute::ResolveLeveledItems(data, input, plan, LinkedDistribution::kDeath);
+		Distribute::Apply(data, input, plan, Outfits::SetDeathOutfit);
+
+		Distribute::LogDistribution(plan.distributedForms, data);
 	}
 
 	RE::BSEventNotifyControl Manager::ProcessEvent(const RE::TESDeathEvent* a_event, RE::BSTEventSource<RE::TESDeathEvent>*)
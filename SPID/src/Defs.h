@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Random.h"
+
 // Record = FormOrEditorID|StringFilters|RawFormFilters|LevelFilters|Traits|IdxOrCount|Chance
 
 using FormModPair = std::pair<
@@ -59,9 +61,9 @@ struct Range
 		return min == max;
 	}
 
-	[[nodiscard]] T GetRandom() const
+	[[nodiscard]] T GetRandom(const Random::Stream& a_stream) const
 	{
-		return IsExact() ? min : RNG().generate<T>(min, max);
+		return IsExact() ? min : a_stream.Count<T>(min, max);
 	}
 
 	// members
@@ -7,180 +7,361 @@
 
 namespace Distribute
 {
-	void Distribute(NPCData& npcData, const PCLevelMult::Input& input, Forms::DistributionSet& forms, DistributedForms* accumulatedForms, OutfitDistributor distributeOutfit)
+	namespace detail
+	{
+		/// <summary>
+		/// Adds collected items to NPC's container.
+		///
+		/// Items that NPC already has only get their counts increased in place,
+		/// so the std::map that CommonLib takes is built only for items that need new container entries.
+		/// </summary>
+		bool add_objects(RE::TESNPC* a_npc, ItemCounts<RE::TESBoundObject>& a_objects)
+		{
+			for (std::uint32_t i = 0; i < a_npc->numContainerObjects && !a_objects.empty(); ++i) {
+				if (const auto entry = a_npc->containerObjects[i]; entry && entry->obj) {
+					if (const auto it = a_objects.find(entry->obj); it != a_objects.end()) {
+						entry->count += it->second;
+						a_objects.erase(it);
+					}
+				}
+			}
+
+			if (a_objects.empty()) {
+				return true;
+			}
+
+			std::map<RE::TESBoundObject*, Count> newObjects{};
+			for (const auto& [object, count] : a_objects) {
+				newObjects.emplace_hint(newObjects.end(), object, count);
+			}
+			return a_npc->AddObjectsToContainer(newObjects, a_npc);
+		}
+
+		/// Inserts a package into NPC's packages at the given index or sets a package list as one of NPC's package lists.
+		void add_package(RE::TESNPC* a_npc, RE::TESForm* a_packageOrList, Index a_index)
+		{
+			if (const auto package = a_packageOrList->As<RE::TESPackage>()) {
+				if (a_index > 0) {
+					--a_index;  //get actual position we want to insert at
+				}
+
+				auto& packageList = a_npc->aiPackages.packages;
+				if (packageList.empty() || a_index == 0) {
+					packageList.push_front(package);
+				} else {
+					auto idxIt = packageList.begin();
+					for (idxIt; idxIt != packageList.end(); ++idxIt) {
+						auto idx = std::distance(packageList.begin(), idxIt);
+						if (a_index == idx) {
+							break;
+						}
+					}
+					if (idxIt != packageList.end()) {
+						packageList.insert_after(idxIt, package);
+					}
+				}
+			} else if (const auto packageList = a_packageOrList->As<RE::BGSListForm>()) {
+				switch (a_index) {
+				case 0:
+					a_npc->defaultPackList = packageList;
+					break;
+				case 1:
+					a_npc->spectatorOverRidePackList = packageList;
+					break;
+				case 2:
+					a_npc->observeCorpseOverRidePackList = packageList;
+					break;
+				case 3:
+					a_npc->guardWarnOverRidePackList = packageList;
+					break;
+				case 4:
+					a_npc->enterCombatOverRidePackList = packageList;
+					break;
+				default:
+					break;
+				}
+			}
+		}
+	}
+
+	void Plan(NPCData& npcData, const PCLevelMult::Input& input, Forms::DistributionSet& forms, DistributionPlan& plan)
 	{
 		const auto npc = npcData.GetNPC();
-		const auto actor = npcData.GetActor();
+
+		// NPC might have changed since verdicts were memoized by a previous distribution.
+		npcData.ClearVerdicts();
 
 		for_each_form<RE::BGSKeyword>(
 			npcData, forms.keywords, input, [&](const std::vector<RE::BGSKeyword*>& a_keywords) {
-				npc->AddKeywords(a_keywords);
+				plan.keywords.insert(plan.keywords.end(), a_keywords.begin(), a_keywords.end());
 			},
-			accumulatedForms);
+			&plan);
 
 		for_each_form<RE::TESFaction>(
 			npcData, forms.factions, input, [&](const std::vector<RE::TESFaction*>& a_factions) {
-				npc->factions.reserve(static_cast<std::uint32_t>(a_factions.size()));
-				for (auto& faction : a_factions) {
-					npc->factions.emplace_back(RE::FACTION_RANK{ faction, 1 });
-				}
+				plan.factions.insert(plan.factions.end(), a_factions.begin(), a_factions.end());
+				npcData.InsertMembers(a_factions);
 			},
-			accumulatedForms);
+			&plan);
 
 		for_each_form<RE::BGSPerk>(
 			npcData, forms.perks, input, [&](const std::vector<RE::BGSPerk*>& a_perks) {
-				npc->AddPerks(a_perks, 1);
+				plan.perks.insert(plan.perks.end(), a_perks.begin(), a_perks.end());
+				npcData.InsertMembers(a_perks);
 			},
-			accumulatedForms);
+			&plan);
 
-		// Note: Abilities are persisted, so that once applied they stick on NPCs.
-		// Maybe one day we should add a system similar to outfits :)
-		// or at least implement RemoveSpell calls for all previous abilities.
 		for_each_form<RE::SpellItem>(
-			npcData, forms.spells, input, [&](const std::vector<RE::SpellItem*>& spells) {
-				for (auto& spell : spells) {
-					actor->AddSpell(spell);  // Adding spells one by one to actor properly applies them. This solves On Death distribution issue #60
-				}
+			npcData, forms.spells, input, [&](const std::vector<RE::SpellItem*>& a_spells) {
+				plan.spells.insert(plan.spells.end(), a_spells.begin(), a_spells.end());
 			},
-			accumulatedForms);
+			&plan);
 
 		for_each_form<RE::TESLevSpell>(
-			npcData, forms.levSpells, input, [&](const std::vector<RE::TESLevSpell*>& levSpells) {
-				npc->GetSpellList()->AddLevSpells(levSpells);
+			npcData, forms.levSpells, input, [&](const std::vector<RE::TESLevSpell*>& a_levSpells) {
+				plan.levSpells.insert(plan.levSpells.end(), a_levSpells.begin(), a_levSpells.end());
+				npcData.InsertMembers(a_levSpells);
 			},
-			accumulatedForms);
+			&plan);
 
 		for_each_form<RE::TESShout>(
 			npcData, forms.shouts, input, [&](const std::vector<RE::TESShout*>& a_shouts) {
-				npc->GetSpellList()->AddShouts(a_shouts);
+				plan.shouts.insert(plan.shouts.end(), a_shouts.begin(), a_shouts.end());
+				npcData.InsertMembers(a_shouts);
 			},
-			accumulatedForms);
+			&plan);
 
 		for_each_form<RE::TESForm>(
-			npcData, forms.packages, input, [&](auto* a_packageOrList, [[maybe_unused]] IndexOrCount a_idx) {
-				auto packageIdx = std::get<Index>(a_idx);
-
+			npcData, forms.packages, input, [&](auto* a_packageOrList, IndexOrCount a_idx) {
 				if (a_packageOrList->Is(RE::FormType::Package)) {
-					auto package = a_packageOrList->As<RE::TESPackage>();
-
-					if (packageIdx > 0) {
-						--packageIdx;  //get actual position we want to insert at
-					}
-
-					auto& packageList = npc->aiPackages.packages;
-					if (std::ranges::find(packageList, package) == packageList.end()) {
-						if (packageList.empty() || packageIdx == 0) {
-							packageList.push_front(package);
-						} else {
-							auto idxIt = packageList.begin();
-							for (idxIt; idxIt != packageList.end(); ++idxIt) {
-								auto idx = std::distance(packageList.begin(), idxIt);
-								if (packageIdx == idx) {
-									break;
-								}
-							}
-							if (idxIt != packageList.end()) {
-								packageList.insert_after(idxIt, package);
-							}
-						}
-					}
-				} else if (a_packageOrList->Is(RE::FormType::FormList)) {
-					auto packageList = a_packageOrList->As<RE::BGSListForm>();
-
-					switch (packageIdx) {
-					case 0:
-						npc->defaultPackList = packageList;
-						break;
-					case 1:
-						npc->spectatorOverRidePackList = packageList;
-						break;
-					case 2:
-						npc->observeCorpseOverRidePackList = packageList;
-						break;
-					case 3:
-						npc->guardWarnOverRidePackList = packageList;
-						break;
-					case 4:
-						npc->enterCombatOverRidePackList = packageList;
-						break;
-					default:
-						break;
+					if (npcData.HasMember(a_packageOrList)) {
+						return;
 					}
+					npcData.InsertMember(a_packageOrList);
+				} else if (!a_packageOrList->Is(RE::FormType::FormList)) {
+					return;
 				}
+				plan.packages.push_back({ a_packageOrList, std::get<Index>(a_idx) });
 			},
-			accumulatedForms);
+			&plan);
 
 		for_each_form<RE::TESBoundObject>(
-			npcData, forms.items, input, [&](std::map<RE::TESBoundObject*, Count>& a_objects) {
-				// TODO: Per-actor item distribution. Would require similar manager as in outfits :) but would be cool, right?
-				// adding objects to actors directly put them in inventory changes, so these items are baked into the save.
-				// to mitiage it, we would need to remove such items whenever a new distribution is triggered.
-				/*for (auto object : a_objects) {
-					actor->AddObjectToContainer(object.first, nullptr, object.second, actor);
+			npcData, forms.items, input, [&](ItemCounts<RE::TESBoundObject>& a_objects, std::span<const PlannedLeveledItem> a_leveledItems) {
+				for (const auto& [object, count] : a_objects) {
+					plan.items[object] += count;
 				}
-				return true;*/
-				return npc->AddObjectsToContainer(a_objects, npc);
+				plan.leveledItems.insert(plan.leveledItems.end(), a_leveledItems.begin(), a_leveledItems.end());
 			},
-			accumulatedForms);
+			&plan);
 
+		// Skins and outfits are compared with the ones that were already planned, as they would have replaced NPC's own by now.
 		for_first_form<RE::TESObjectARMO>(
 			npcData, forms.skins, input, [&](auto* a_skin, bool isFinal) {
-				if (npc->skin != a_skin) {
-					npc->skin = a_skin;
+				if ((plan.skin ? plan.skin : npc->skin) != a_skin) {
+					plan.skin = a_skin;
 					return true;
 				}
 				return false;
 			},
-			accumulatedForms);
+			&plan);
 
 		for_first_form<RE::BGSOutfit>(
 			npcData, forms.sleepOutfits, input, [&](auto* a_outfit, bool isFinal) {
-				if (npc->sleepOutfit != a_outfit) {
-					npc->sleepOutfit = a_outfit;
+				if ((plan.sleepOutfit ? plan.sleepOutfit : npc->sleepOutfit) != a_outfit) {
+					plan.sleepOutfit = a_outfit;
 					return true;
 				}
 				return false;
 			},
-			accumulatedForms);
+			&plan);
 
 		for_first_form<RE::BGSOutfit>(
-			npcData, forms.outfits, input, [&](auto* outfit, bool isFinal) {
-				return distributeOutfit(npcData, outfit, isFinal);  // terminate as soon as valid outfit is confirmed.
+			npcData, forms.outfits, input, [&](auto* a_outfit, bool isFinal) {
+				// Outfit distributors reject outfits that NPC can't wear, so the first one that it can wear is planned.
+				if (Outfits::Manager::GetSingleton()->CanEquipOutfit(npcData.GetActor(), a_outfit)) {
+					plan.outfits.push_back({ a_outfit, isFinal });
+					return true;
+				}
+				return false;
 			},
-			accumulatedForms);
+			&plan);
 	}
 
-	void Distribute(NPCData& npcData, const PCLevelMult::Input& input)
+	void ResolveLeveledItems(NPCData& npcData, const PCLevelMult::Input& input, DistributionPlan& plan, LinkedDistribution::DistributionType type)
 	{
-		if (input.onlyPlayerLevelEntries && PCLevelMult::Manager::GetSingleton()->HasHitLevelCap(input))
-			return;
+		// Linked forms might include more leveled lists, so they are resolved until none are left. Each resolved item is expanded once, even if links form a cycle.
+		DistributedForms expanded{};
 
-		Forms::DistributionSet entries{
-			Forms::spells.GetForms(input.onlyPlayerLevelEntries),
-			Forms::perks.GetForms(input.onlyPlayerLevelEntries),
-			Forms::items.GetForms(input.onlyPlayerLevelEntries),
-			Forms::shouts.GetForms(input.onlyPlayerLevelEntries),
-			Forms::levSpells.GetForms(input.onlyPlayerLevelEntries),
-			Forms::packages.GetForms(input.onlyPlayerLevelEntries),
-			Forms::DistributionSet::empty<RE::BGSOutfit>(),  // Outfits are distributed separately.
-			Forms::keywords.GetForms(input.onlyPlayerLevelEntries),
-			Forms::factions.GetForms(input.onlyPlayerLevelEntries),
-			Forms::sleepOutfits.GetForms(input.onlyPlayerLevelEntries),
-			Forms::skins.GetForms(input.onlyPlayerLevelEntries)
-		};
+		while (!plan.leveledItems.empty()) {
+			DistributedForms resolved{};
+
+			for (const auto& [list, count, path] : std::exchange(plan.leveledItems, {})) {
+				auto& calcedObjects = detail::get_calced_objects();
+
+				list->CalculateCurrentFormList(npcData.GetLevel(), count, calcedObjects, 0, true);
+				for (const auto& calcObj : calcedObjects) {
+					plan.items[static_cast<RE::TESBoundObject*>(calcObj.form)] += calcObj.count;
+					plan.distributedForms.insert({ calcObj.form, path });
+					if (expanded.insert({ calcObj.form, path })) {
+						resolved.insert({ calcObj.form, path });
+					}
+				}
+			}
+
+			if (!resolved.empty()) {
+				LinkedDistribution::Manager::GetSingleton()->ForEachLinkedDistributionSet(type, resolved, [&](Forms::DistributionSet& set) {
+					Plan(npcData, input, set, plan);
+				});
+			}
+		}
+	}
 
-		DistributedForms distributedForms{};
+	void Apply(const NPCData& npcData, const PCLevelMult::Input& input, DistributionPlan& plan, OutfitDistributor distributeOutfit)
+	{
+		const auto npc = npcData.GetNPC();
+		const auto actor = npcData.GetActor();
 
-		Distribute(npcData, input, entries, &distributedForms, Outfits::SetDefaultOutfit);
+		if (!plan.keywords.empty()) {
+			npc->AddKeywords(plan.keywords);
+		}
 
-		if (!distributedForms.empty()) {
-			// TODO: This only does one-level linking. So that linked entries won't trigger another level of distribution.
-			LinkedDistribution::Manager::GetSingleton()->ForEachLinkedDistributionSet(LinkedDistribution::kRegular, distributedForms, [&](Forms::DistributionSet& set) {
-				Distribute(npcData, input, set, &distributedForms, Outfits::SetDefaultOutfit);
-			});
+		if (!plan.factions.empty()) {
+			npc->factions.reserve(static_cast<std::uint32_t>(npc->factions.size() + plan.factions.size()));
+			for (auto& faction : plan.factions) {
+				npc->factions.emplace_back(RE::FACTION_RANK{ faction, 1 });
+			}
 		}
 
-		LogDistribution(distributedForms, npcData);
+		if (!plan.perks.empty()) {
+			npc->AddPerks(plan.perks, 1);
+		}
+
+		// Note: Abilities are persisted, so that once applied they stick on NPCs.
+		// Maybe one day we should add a system similar to outfits :)
+		// or at least implement RemoveSpell calls for all previous abilities.
+		for (auto& spell : plan.spells) {
+			actor->AddSpell(spell);  // Adding spells one by one to actor properly applies them. This solves On Death distribution issue #60
+		}
+
+		if (!plan.levSpells.empty()) {
+			npc->GetSpellList()->AddLevSpells(plan.levSpells);
+		}
+
+		if (!plan.shouts.empty()) {
+			npc->GetSpellList()->AddShouts(plan.shouts);
+		}
+
+		for (const auto& [packageOrList, index] : plan.packages) {
+			detail::add_package(npc, packageOrList, index);
+		}
+
+		if (!plan.items.empty()) {
+			// TODO: Per-actor item distribution. Would require similar manager as in outfits :) but would be cool, right?
+			// adding objects to actors directly put them in inventory changes, so these items are baked into the save.
+			// to mitiage it, we would need to remove such items whenever a new distribution is triggered.
+			/*for (auto object : plan.items) {
+				actor->AddObjectToContainer(object.first, nullptr, object.second, actor);
+			}*/
+			detail::add_objects(npc, plan.items);
+		}
+
+		if (plan.skin) {
+			npc->skin = plan.skin;
+		}
+
+		if (plan.sleepOutfit) {
+			npc->sleepOutfit = plan.sleepOutfit;
+		}
+
+		for (const auto& [outfit, isFinal] : plan.outfits) {
+			distributeOutfit(npcData, outfit, isFinal);
+		}
+
+		for (const auto npcCount : plan.npcCounts) {
+			++*npcCount;
+		}
+
+		const auto pcLevelMultManager = PCLevelMult::Manager::GetSingleton();
+		for (const auto& [formID, index] : plan.rejectedEntries) {
+			pcLevelMultManager->InsertRejectedEntry(input, formID, index);
+		}
+		for (const auto& [type, formIDs] : plan.leveledEntries) {
+			pcLevelMultManager->InsertDistributedEntry(input, type, formIDs);
+		}
+	}
+
+	namespace detail
+	{
+		/// Plans distribution of given forms and forms that are linked to them.
+		void plan_linked(NPCData& npcData, const PCLevelMult::Input& input, Forms::DistributionSet& entries, DistributionPlan& plan)
+		{
+			Plan(npcData, input, entries, plan);
+
+			if (!plan.distributedForms.empty()) {
+				LinkedDistribution::Manager::GetSingleton()->ForEachLinkedDistributionSet(LinkedDistribution::kRegular, plan.distributedForms, [&](Forms::DistributionSet& set) {
+					Plan(npcData, input, set, plan);
+				});
+			}
+		}
+
+		/// Plans distribution of all configured forms and forms that are linked to them, without the plan cache.
+		void plan_all(NPCData& npcData, const PCLevelMult::Input& input, DistributionPlan& plan)
+		{
+			Forms::DistributionSet entries{
+				Forms::spells.GetForms(input.onlyPlayerLevelEntries),
+				Forms::perks.GetForms(input.onlyPlayerLevelEntries),
+				Forms::items.GetForms(input.onlyPlayerLevelEntries),
+				Forms::shouts.GetForms(input.onlyPlayerLevelEntries),
+				Forms::levSpells.GetForms(input.onlyPlayerLevelEntries),
+				Forms::packages.GetForms(input.onlyPlayerLevelEntries),
+				Forms::DistributionSet::empty<RE::BGSOutfit>(),  // Outfits are distributed separately.
+				Forms::keywords.GetForms(input.onlyPlayerLevelEntries),
+				Forms::factions.GetForms(input.onlyPlayerLevelEntries),
+				Forms::sleepOutfits.GetForms(input.onlyPlayerLevelEntries),
+				Forms::skins.GetForms(input.onlyPlayerLevelEntries)
+			};
+
+			plan_linked(npcData, input, entries, plan);
+		}
+	}
+
+	void Plan(NPCData& npcData, const PCLevelMult::Input& input, DistributionPlan& plan)
+	{
+		const auto cache = PlanCache::Manager::GetSingleton();
+
+		const auto key = cache->GetKey(npcData, input);
+		if (!key) {
+			detail::plan_all(npcData, input, plan);
+			return;
+		}
+
+		if (const auto trace = cache->Find(*key)) {
+			PlanCache::Session session{ *trace };
+			detail::plan_all(npcData, input, plan);
+			cache->CountHit(session.HasDiverged());
+		} else {
+			PlanCache::Trace recorded{};
+			{
+				PlanCache::Session session{ recorded };
+				detail::plan_all(npcData, input, plan);
+			}
+			cache->Insert(*key, std::move(recorded));
+			cache->CountMiss();
+		}
+	}
+
+	void Distribute(NPCData& npcData, const PCLevelMult::Input& input)
+	{
+		if (input.onlyPlayerLevelEntries && PCLevelMult::Manager::GetSingleton()->HasHitLevelCap(input))
+			return;
+
+		DistributionPlan plan{};
+
+		Plan(npcData, input, plan);
+		ResolveLeveledItems(npcData, input, plan, LinkedDistribution::kRegular);
+		Apply(npcData, input, plan, Outfits::SetDefaultOutfit);
+
+		LogDistribution(plan.distributedForms, npcData);
 	}
 
 	void DistributeOutfits(NPCData& npcData, const PCLevelMult::Input& input)
@@ -202,11 +383,12 @@ namespace Distribute
 			Forms::DistributionSet::empty<RE::TESObjectARMO>()
 		};
 
-		DistributedForms distributedForms{};
+		DistributionPlan plan{};
 
-		Distribute(npcData, input, entries, &distributedForms, Outfits::SetDefaultOutfit);
+		Plan(npcData, input, entries, plan);
+		Apply(npcData, input, plan, Outfits::SetDefaultOutfit);
 
-		LogDistribution(distributedForms, npcData, true);
+		LogDistribution(plan.distributedForms, npcData, true);
 	}
 
 	void Distribute(NPCData& npcData, bool onlyLeveledEntries)
@@ -227,13 +409,103 @@ namespace Distribute
 		DistributeOutfits(npcData, input);
 	}
 
+	void PlanLevelChange(NPCData& npcData, const PCLevelMult::Input& input, std::uint16_t oldLevel, DistributionPlan& plan)
+	{
+		const auto newLevel = input.npcLevel;
+
+		const auto crossedEntries = [&]<class Form>(Forms::Distributables<Form>& a_distributable) -> Forms::DataVec<Form>& {
+			return a_distributable.GetForms(oldLevel, newLevel);
+		};
+
+		// Crossed entries are planned for a separate copy of NPC's data first, so that NPC can still be planned from scratch if they give anything.
+		// That plan is never applied, so it doesn't count NPCs on entries or write to PCLevelMult::Manager.
+		bool crossedPassed;
+		{
+			NPCData                crossedData{ npcData.GetActor(), npcData.GetNPC() };
+			DistributionPlan       crossedPlan{};
+			Forms::DistributionSet entries{
+				crossedEntries(Forms::spells),
+				crossedEntries(Forms::perks),
+				Forms::DistributionSet::empty<RE::TESBoundObject>(),  // Items are given on every level change, see below.
+				crossedEntries(Forms::shouts),
+				crossedEntries(Forms::levSpells),
+				crossedEntries(Forms::packages),
+				Forms::DistributionSet::empty<RE::BGSOutfit>(),
+				crossedEntries(Forms::keywords),
+				crossedEntries(Forms::factions),
+				crossedEntries(Forms::sleepOutfits),
+				crossedEntries(Forms::skins)
+			};
+			detail::plan_linked(crossedData, input, entries, crossedPlan);
+			crossedPassed = !crossedPlan.distributedForms.empty() || !crossedPlan.leveledItems.empty();
+
+			// Entries are not planned again when none of them passed, so their chance rejections are kept from this plan.
+			if (!crossedPassed) {
+				plan.rejectedEntries.insert(plan.rejectedEntries.end(), crossedPlan.rejectedEntries.begin(), crossedPlan.rejectedEntries.end());
+			}
+		}
+
+		// Forms that crossed entries give might be required by filters of any other leveled entry, so in that case all of them are planned again.
+		// Otherwise NPC looks to the rest of the entries just like it did at the previous level. Items are given again on every level change either way.
+		Forms::DistributionSet entries{
+			crossedPassed ? Forms::spells.GetForms(true) : Forms::DistributionSet::empty<RE::SpellItem>(),
+			crossedPassed ? Forms::perks.GetForms(true) : Forms::DistributionSet::empty<RE::BGSPerk>(),
+			Forms::items.GetForms(true),
+			crossedPassed ? Forms::shouts.GetForms(true) : Forms::DistributionSet::empty<RE::TESShout>(),
+			crossedPassed ? Forms::levSpells.GetForms(true) : Forms::DistributionSet::empty<RE::TESLevSpell>(),
+			crossedPassed ? Forms::packages.GetForms(true) : Forms::DistributionSet::empty<RE::TESForm>(),
+			Forms::DistributionSet::empty<RE::BGSOutfit>(),  // Outfits are planned separately, without linked forms.
+			crossedPassed ? Forms::keywords.GetForms(true) : Forms::DistributionSet::empty<RE::BGSKeyword>(),
+			crossedPassed ? Forms::factions.GetForms(true) : Forms::DistributionSet::empty<RE::TESFaction>(),
+			crossedPassed ? Forms::sleepOutfits.GetForms(true) : Forms::DistributionSet::empty<RE::BGSOutfit>(),
+			crossedPassed ? Forms::skins.GetForms(true) : Forms::DistributionSet::empty<RE::TESObjectARMO>()
+		};
+		detail::plan_linked(npcData, input, entries, plan);
+
+		Forms::DistributionSet outfitEntries{
+			Forms::DistributionSet::empty<RE::SpellItem>(),
+			Forms::DistributionSet::empty<RE::BGSPerk>(),
+			Forms::DistributionSet::empty<RE::TESBoundObject>(),
+			Forms::DistributionSet::empty<RE::TESShout>(),
+			Forms::DistributionSet::empty<RE::TESLevSpell>(),
+			Forms::DistributionSet::empty<RE::TESForm>(),
+			crossedPassed ? Forms::outfits.GetForms(true) : crossedEntries(Forms::outfits),
+			Forms::DistributionSet::empty<RE::BGSKeyword>(),
+			Forms::DistributionSet::empty<RE::TESFaction>(),
+			Forms::DistributionSet::empty<RE::BGSOutfit>(),
+			Forms::DistributionSet::empty<RE::TESObjectARMO>()
+		};
+		Plan(npcData, input, outfitEntries, plan);
+	}
+
+	void DistributeLevelChange(NPCData& npcData)
+	{
+		const auto pcLevelMultManager = PCLevelMult::Manager::GetSingleton();
+		const auto input = PCLevelMult::Input{ npcData.GetActor(), npcData.GetNPC(), true };
+
+		const auto oldLevel = pcLevelMultManager->FindDistributedLevel(input);
+		if (!oldLevel) {
+			Distribute(npcData, input);
+			DistributeOutfits(npcData, input);
+		} else if (!pcLevelMultManager->HasHitLevelCap(input)) {
+			DistributionPlan plan{};
+			PlanLevelChange(npcData, input, *oldLevel, plan);
+			ResolveLeveledItems(npcData, input, plan, LinkedDistribution::kRegular);
+			Apply(npcData, input, plan, Outfits::SetDefaultOutfit);
+
+			LogDistribution(plan.distributedForms, npcData);
+		}
+
+		pcLevelMultManager->SetDistributedLevel(input);
+	}
+
 	void LogDistribution(const DistributedForms& forms, NPCData& npcData, bool append)
 	{
 		//#ifndef NDEBUG
 		std::map<std::string_view, std::vector<DistributedForm>> results;
 
 		for (const auto& form : forms) {
-			results[RE::FormTypeToString(form.first->GetFormType())].push_back(form);
+			results[RE::FormTypeToString(form.form->GetFormType())].push_back(form);
 		}
 
 		if (!append) {
@@ -247,7 +519,7 @@ namespace Distribute
 			for (const auto& pair : results) {
 				logger::info("\t{}", pair.first);
 				for (const auto& form : pair.second) {
-					logger::info("\t\t{} @ {}", *form.first, form.second);
+					logger::info("\t\t{} @ {}", *form.form, Paths::Get(form.path));
 				}
 			}
 		}
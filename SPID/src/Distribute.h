@@ -1,18 +1,146 @@
 #pragma once
 
 #include "FormData.h"
+#include "LinkedDistribution.h"
 #include "LookupNPC.h"
 #include "PCLevelMultManager.h"
+#include "PlanCache.h"
+#include "SmallMap.h"
 
 namespace Distribute
 {
+	/// Counts of items collected for a single NPC.
+	/// Most NPCs receive only a few items, so they are kept inline and collecting them doesn't allocate.
+	template <class Form>
+	using ItemCounts = SmallMap<Form*, Count, 16>;
+
+	/// <summary>
+	/// A leveled list of items that passed filters, along with the count that was rolled for it.
+	///
+	/// Leveled lists are resolved by the game, which isn't known to be thread-safe,
+	/// so they are only collected while planning and resolved on the main thread by ResolveLeveledItems.
+	/// </summary>
+	struct PlannedLeveledItem
+	{
+		RE::TESLevItem* list{ nullptr };
+		Count           count{ 0 };
+		Paths::ID       path{ Paths::none };
+	};
+
+	/// An entry with Level Filters that failed its chance roll, see PCLevelMult::Manager::InsertRejectedEntry.
+	struct RejectedEntry
+	{
+		RE::FormID    formID{ 0 };
+		std::uint32_t index{ 0 };
+	};
+
+	/// Forms of a single type that entries with Level Filters gave, see PCLevelMult::Manager::InsertDistributedEntry.
+	struct PlannedLeveledEntries
+	{
+		RE::FormType    type{};
+		Set<RE::FormID> formIDs{};
+	};
+
+	/// A package or a package list along with the index that it was configured with.
+	struct PlannedPackage
+	{
+		RE::TESForm* form{ nullptr };
+		Index        index{ 0 };
+	};
+
+	/// An outfit along with whether it was configured as final.
+	struct PlannedOutfit
+	{
+		RE::BGSOutfit* outfit{ nullptr };
+		bool           isFinal{ false };
+	};
+
+	/// <summary>
+	/// Forms that distribution decided to give to an NPC.
+	///
+	/// Planning doesn't modify the game. Instead it records planned forms in NPCData,
+	/// which serves as a snapshot of NPC that following entries are filtered against.
+	/// The plan is then committed to the game by Apply.
+	/// </summary>
+	struct DistributionPlan
+	{
+		std::vector<RE::BGSKeyword*>    keywords{};
+		std::vector<RE::TESFaction*>    factions{};
+		std::vector<RE::BGSPerk*>       perks{};
+		std::vector<RE::SpellItem*>     spells{};
+		std::vector<RE::TESLevSpell*>   levSpells{};
+		std::vector<RE::TESShout*>      shouts{};
+		std::vector<PlannedPackage>     packages{};
+		ItemCounts<RE::TESBoundObject>  items{};
+		std::vector<PlannedLeveledItem> leveledItems{};  // Resolved into items by ResolveLeveledItems.
+		RE::TESObjectARMO*              skin{ nullptr };
+		RE::BGSOutfit*                  sleepOutfit{ nullptr };
+		std::vector<PlannedOutfit>      outfits{};  // Outfits are registered in order, so that the manager can resolve them the same way as when they were set one by one.
+
+		/// All planned forms and configs that they come from.
+		Forms::DistributedForms distributedForms{};
+
+		// Entries and PCLevelMult::Manager are shared by all NPCs, so planning only records what it would change in them.
+		// Apply commits these along with the forms, which keeps plans that are discarded or made again from counting twice.
+		std::vector<std::uint32_t*>        npcCounts{};  // Counters of entries that gave forms, see Forms::Data::npcCount.
+		std::vector<RejectedEntry>         rejectedEntries{};
+		std::vector<PlannedLeveledEntries> leveledEntries{};
+	};
+
 	namespace detail
 	{
+		/// Returns rolls for the entry and the actor.
+		template <class Form>
+		Random::Stream random_stream(const NPCData& a_npcData, const Forms::Data<Form>& a_formData)
+		{
+			return { a_npcData.GetActor()->GetFormID(), a_formData.form->GetFormID(), a_formData.index };
+		}
+
+		/// <summary>
+		/// Same as Filter::Data::PassedFiltersMemoized, but reports decisions to the plan cache session.
+		///
+		/// When the session replays a Trace, it provides verdicts that are not memoized yet instead of evaluating Programs.
+		/// </summary>
+		template <class Form>
+		Filter::Result passed_filters_traced(
+			const NPCData&           a_npcData,
+			const Forms::Data<Form>& a_formData,
+			PlanCache::Session&      a_session)
+		{
+			const auto& filters = a_formData.filters;
+
+			if (filters.chance < 1) {
+				const auto passed = random_stream(a_npcData, a_formData).Chance() <= filters.chance;
+				a_session.Roll(static_cast<std::uint64_t>(a_formData.form->GetFormID()) << 32 | a_formData.index, passed);
+				if (!passed) {
+					return Filter::Result::kFailRNG;
+				}
+			}
+
+			auto verdict = a_npcData.GetVerdict(filters.programID);
+			if (!verdict) {
+				verdict = a_session.Replay(filters.programID);
+				if (!verdict) {
+					verdict = filters.program.Evaluate(a_npcData);
+				}
+				a_npcData.SetVerdict(filters.programID, *verdict);
+			}
+			a_session.Verdict(filters.programID, *verdict);
+
+			return *verdict ? Filter::Result::kPass : Filter::Result::kFail;
+		}
+
+		/// <summary>
+		/// Checks filters of the entry, taking into account entries that PCLevelMult::Manager remembers as rejected for the NPC.
+		///
+		/// Entries with Level Filters that fail their chance roll are recorded in a_plan, if it is given, so that Apply remembers them as rejected.
+		/// </summary>
 		template <class Form>
 		bool passed_filters(
 			const NPCData&            a_npcData,
 			const PCLevelMult::Input& a_input,
-			const Forms::Data<Form>&  a_formData)
+			const Forms::Data<Form>&  a_formData,
+			DistributionPlan*         a_plan)
 		{
 			const auto pcLevelMultManager = PCLevelMult::Manager::GetSingleton();
 
@@ -24,11 +152,13 @@ namespace Distribute
 				return false;
 			}
 
-			auto result = a_formData.filters.PassedFilters(a_npcData);
+			// Entries with equal filters share the verdict, which is computed only for the first of them.
+			const auto session = PlanCache::Session::GetActive();
+			auto       result = session ? passed_filters_traced(a_npcData, a_formData, *session) : a_formData.filters.PassedFiltersMemoized(a_npcData, random_stream(a_npcData, a_formData));
 
 			if (result != Filter::Result::kPass) {
-				if (hasLevelFilters && result == Filter::Result::kFailRNG) {
-					pcLevelMultManager->InsertRejectedEntry(a_input, distributedFormID, index);
+				if (hasLevelFilters && result == Filter::Result::kFailRNG && a_plan) {
+					a_plan->rejectedEntries.push_back({ distributedFormID, index });
 				}
 				return false;
 			}
@@ -41,122 +171,227 @@ namespace Distribute
 			const NPCData&           a_npcData,
 			const Forms::Data<Form>& a_formData)
 		{
-			return a_formData.filters.PassedFilters(a_npcData) == Filter::Result::kPass;
+			return a_formData.filters.PassedFilters(a_npcData, random_stream(a_npcData, a_formData)) == Filter::Result::kPass;
+		}
+
+		/// Records the form that the entry gave in a_plan, if it is given. The entry counts the NPC once the plan is applied.
+		template <class Form>
+		void record_form(DistributionPlan* a_plan, Forms::Data<Form>& a_formData)
+		{
+			if (a_plan) {
+				a_plan->distributedForms.insert({ a_formData.form, a_formData.path });
+				a_plan->npcCounts.push_back(&a_formData.npcCount);
+			}
 		}
 
 		/// <summary>
 		/// Check that NPC doesn't already have the form that is about to be distributed.
 		/// </summary>
 		template <class Form>
-		bool has_form(RE::TESNPC* a_npc, Form* a_form)
+		bool has_form(const NPCData& a_npcData, Form* a_form)
 		{
-			if constexpr (std::is_same_v<RE::TESFaction, Form>) {
-				return a_npc->IsInFaction(a_form);
-			} else if constexpr (std::is_same_v<RE::BGSPerk, Form>) {
-				return a_npc->GetPerkIndex(a_form).has_value();
-			} else if constexpr (std::is_same_v<RE::SpellItem, Form> || std::is_same_v<RE::TESShout, Form> || std::is_same_v<RE::TESLevSpell, Form>) {
-				const auto actorEffects = a_npc->GetSpellList();
-				return actorEffects && actorEffects->GetIndex(a_form).has_value();
+			if constexpr (std::is_same_v<RE::TESFaction, Form> || std::is_same_v<RE::BGSPerk, Form> || std::is_same_v<RE::SpellItem, Form> || std::is_same_v<RE::TESShout, Form> || std::is_same_v<RE::TESLevSpell, Form>) {
+				return a_npcData.HasMember(a_form);
 			} else if constexpr (std::is_same_v<RE::TESForm, Form>) {
-				if (a_form->Is(RE::TESPackage::FORMTYPE)) {
-					auto  package = a_form->As<RE::TESPackage>();
-					auto& packageList = a_npc->aiPackages.packages;
-					return std::ranges::find(packageList, package) != packageList.end();
-				} else {
-					return false;
-				}
+				return a_form->Is(RE::TESPackage::FORMTYPE) && a_npcData.HasMember(a_form);
 			} else {
 				return false;
 			}
 		}
+
+		/// <summary>
+		/// Returns the candidate set of the current thread for entries of the given type.
+		///
+		/// Candidates::Index::Collect resets the set, which keeps its capacity, so candidates are collected without allocating for each NPC.
+		/// </summary>
+		template <class Form>
+		Candidates::Set& get_candidates()
+		{
+			thread_local Candidates::Set candidates{};
+
+			return candidates;
+		}
+
+		/// <summary>
+		/// Calls a_callback for each entry that might pass filters for given NPC, in the order of entries.
+		///
+		/// Uses candidate index of the entries when it is available, otherwise every entry is a candidate.
+		/// </summary>
+		/// <param name="a_callback">A callback that returns false to stop iteration.</param>
+		template <class Form, class Callback>
+		void for_each_candidate(const NPCData& a_npcData, Forms::DataVec<Form>& a_forms, Callback&& a_callback)
+		{
+			const auto& index = a_forms.candidates;
+
+			if (!index.IsValid(a_forms.size())) {
+				for (auto& formData : a_forms) {
+					if (!a_callback(formData)) {
+						return;
+					}
+				}
+				return;
+			}
+
+			auto& candidates = get_candidates<Form>();
+			index.Collect(a_npcData, candidates);
+
+			for (auto i = candidates.next(0); i != Candidates::Set::npos; i = candidates.next(i + 1)) {
+				auto& formData = a_forms[i];
+				if (!a_callback(formData)) {
+					return;
+				}
+				if constexpr (std::is_same_v<RE::BGSKeyword, Form>) {
+					// This keyword might have been just given to the NPC, which makes entries that require it new candidates.
+					index.Collect(formData.form, candidates);
+				}
+			}
+		}
+	}
+
+	namespace detail
+	{
+		/// <summary>
+		/// Containers that for_each_form collects forms of a single type into.
+		///
+		/// They are kept per thread and reused by all distributions on that thread,
+		/// so that their memory is allocated once instead of for each NPC.
+		/// </summary>
+		template <class Form>
+		struct Scratch
+		{
+			std::vector<Form*> forms{};
+			Set<RE::FormID>    formIDs{};
+			Set<RE::FormID>    leveledFormIDs{};
+		};
+
+		/// Returns cleared scratch containers of the current thread.
+		template <class Form>
+		Scratch<Form>& get_scratch()
+		{
+			thread_local Scratch<Form> scratch{};
+
+			scratch.forms.clear();
+			scratch.formIDs.clear();
+			scratch.leveledFormIDs.clear();
+
+			return scratch;
+		}
+
+		/// <summary>
+		/// Returns a cleared buffer of the current thread that leveled items are expanded into.
+		///
+		/// The buffer keeps its capacity, so leveled lists are expanded without allocating for each of them.
+		/// </summary>
+		inline RE::BSScrapArray<RE::CALCED_OBJECT>& get_calced_objects()
+		{
+			thread_local RE::BSScrapArray<RE::CALCED_OBJECT> calcedObjects{};
+
+			calcedObjects.clear();
+
+			return calcedObjects;
+		}
 	}
 
 	using namespace Forms;
 
+	// Callbacks are taken as template parameters, so that they are inlined into distribution of each form type.
+
 #pragma region Packages
 	// old method (distributing one by one)
 	// for now, only packages use this
-	template <class Form>
+	template <class Form, class Callback>
+		requires std::invocable<Callback&, Form*, IndexOrCount>
 	void for_each_form(
-		const NPCData&                           a_npcData,
-		Forms::DataVec<Form>&                    forms,
-		const PCLevelMult::Input&                a_input,
-		std::function<void(Form*, IndexOrCount)> a_callback,
-		DistributedForms*                        accumulatedForms = nullptr)
+		const NPCData&            a_npcData,
+		Forms::DataVec<Form>&     forms,
+		const PCLevelMult::Input& a_input,
+		Callback&&                a_callback,
+		DistributionPlan*         a_plan = nullptr)
 	{
-		for (auto& formData : forms) {
-			if (!a_npcData.HasMutuallyExclusiveForm(formData.form) && detail::passed_filters(a_npcData, a_input, formData)) {
-				if (accumulatedForms) {
-					accumulatedForms->insert({ formData.form, formData.path });
-				}
+		detail::for_each_candidate(a_npcData, forms, [&](Forms::Data<Form>& formData) {
+			if (!a_npcData.HasMutuallyExclusiveForm(formData.form) && detail::passed_filters(a_npcData, a_input, formData, a_plan)) {
+				detail::record_form(a_plan, formData);
 				a_callback(formData.form, formData.idxOrCount);
-				++formData.npcCount;
+				a_npcData.ClearVerdicts();
 			}
-		}
+			return true;
+		});
 	}
 #pragma endregion
 
 #pragma region Outfits, Sleep Outfits, Skins
-	template <class Form>
+	template <class Form, class Callback>
+		requires std::predicate<Callback&, Form*, bool>
 	bool for_first_form(
-		const NPCData&                           a_npcData,
-		Forms::DataVec<Form>&                    forms,
-		const PCLevelMult::Input&                a_input,
-		std::function<bool(Form*, bool isFinal)> a_callback,
-		DistributedForms*                        accumulatedForms = nullptr)
+		const NPCData&            a_npcData,
+		Forms::DataVec<Form>&     forms,
+		const PCLevelMult::Input& a_input,
+		Callback&&                a_callback,
+		DistributionPlan*         a_plan = nullptr)
 	{
-		for (auto& formData : forms) {
-			if (!a_npcData.HasMutuallyExclusiveForm(formData.form) && detail::passed_filters(a_npcData, a_input, formData) && a_callback(formData.form, formData.isFinal)) {
-				if (accumulatedForms) {
-					accumulatedForms->insert({ formData.form, formData.path });
-				}
-				++formData.npcCount;
-				return true;
+		bool distributed = false;
+
+		detail::for_each_candidate(a_npcData, forms, [&](Forms::Data<Form>& formData) {
+			if (!a_npcData.HasMutuallyExclusiveForm(formData.form) && detail::passed_filters(a_npcData, a_input, formData, a_plan) && a_callback(formData.form, formData.isFinal)) {
+				a_npcData.ClearVerdicts();
+				detail::record_form(a_plan, formData);
+				distributed = true;
+				return false;
 			}
-		}
+			return true;
+		});
 
-		return false;
+		return distributed;
 	}
 #pragma endregion
 
 #pragma region Items
+	namespace detail
+	{
+		/// Returns a cleared buffer of the current thread that leveled lists are collected into.
+		inline std::vector<PlannedLeveledItem>& get_leveled_items()
+		{
+			thread_local std::vector<PlannedLeveledItem> leveledItems{};
+
+			leveledItems.clear();
+
+			return leveledItems;
+		}
+	}
+
 	// countable items
-	template <class Form>
+	template <class Form, class Callback>
+		requires std::invocable<Callback&, ItemCounts<Form>&, std::span<const PlannedLeveledItem>>
 	void for_each_form(
-		const NPCData&                               a_npcData,
-		Forms::DataVec<Form>&                        forms,
-		const PCLevelMult::Input&                    a_input,
-		std::function<bool(std::map<Form*, Count>&)> a_callback,
-		DistributedForms*                            accumulatedForms = nullptr)
+		const NPCData&            a_npcData,
+		Forms::DataVec<Form>&     forms,
+		const PCLevelMult::Input& a_input,
+		Callback&&                a_callback,
+		DistributionPlan*         a_plan = nullptr)
 	{
-		std::map<Form*, Count> collectedForms{};
+		ItemCounts<Form> collectedForms{};
+		auto&            collectedLeveledItems = detail::get_leveled_items();
 
-		for (auto& formData : forms) {
-			if (!a_npcData.HasMutuallyExclusiveForm(formData.form) && detail::passed_filters(a_npcData, a_input, formData)) {
-				auto count = std::get<RandomCount>(formData.idxOrCount).GetRandom();
+		detail::for_each_candidate(a_npcData, forms, [&](Forms::Data<Form>& formData) {
+			if (!a_npcData.HasMutuallyExclusiveForm(formData.form) && detail::passed_filters(a_npcData, a_input, formData, a_plan)) {
+				auto count = std::get<RandomCount>(formData.idxOrCount).GetRandom(detail::random_stream(a_npcData, formData));
 				if (auto leveledItem = formData.form->As<RE::TESLevItem>()) {
-					auto                                level = a_npcData.GetLevel();
-					RE::BSScrapArray<RE::CALCED_OBJECT> calcedObjects{};
-
-					leveledItem->CalculateCurrentFormList(level, count, calcedObjects, 0, true);
-					for (auto& calcObj : calcedObjects) {
-						collectedForms[static_cast<RE::TESBoundObject*>(calcObj.form)] += calcObj.count;
-						if (accumulatedForms) {
-							accumulatedForms->insert({ calcObj.form, formData.path });
-						}
+					// Items of the list are recorded once it is resolved, so only the entry's count is recorded here.
+					collectedLeveledItems.push_back({ leveledItem, count, formData.path });
+					if (a_plan) {
+						a_plan->npcCounts.push_back(&formData.npcCount);
 					}
 				} else {
 					collectedForms[formData.form] += count;
-					if (accumulatedForms) {
-						accumulatedForms->insert({ formData.form, formData.path });
-					}
+					detail::record_form(a_plan, formData);
 				}
-				++formData.npcCount;
 			}
-		}
+			return true;
+		});
 
-		if (!collectedForms.empty()) {
-			a_callback(collectedForms);
+		if (!collectedForms.empty() || !collectedLeveledItems.empty()) {
+			a_callback(collectedForms, std::span<const PlannedLeveledItem>{ collectedLeveledItems });
+			a_npcData.ClearVerdicts();
 		}
 	}
 #pragma endregion
@@ -164,76 +399,96 @@ namespace Distribute
 #pragma region Spells, Perks, Shouts, Keywords
 	// spells, perks, shouts, keywords
 	// forms that can be added to
-	template <class Form>
+	template <class Form, class Callback>
+		requires std::invocable<Callback&, const std::vector<Form*>&>
 	void for_each_form(
-		NPCData&                                       a_npcData,
-		Forms::DataVec<Form>&                          forms,
-		const PCLevelMult::Input&                      a_input,
-		std::function<void(const std::vector<Form*>&)> a_callback,
-		DistributedForms*                              accumulatedForms = nullptr)
+		NPCData&                  a_npcData,
+		Forms::DataVec<Form>&     forms,
+		const PCLevelMult::Input& a_input,
+		Callback&&                a_callback,
+		DistributionPlan*         a_plan = nullptr)
 	{
-		const auto npc = a_npcData.GetNPC();
-
-		std::vector<Form*> collectedForms{};
-		Set<RE::FormID>    collectedFormIDs{};
-		Set<RE::FormID>    collectedLeveledFormIDs{};
+		auto& [collectedForms, collectedFormIDs, collectedLeveledFormIDs] = detail::get_scratch<Form>();
 
-		collectedForms.reserve(forms.size());
-		collectedFormIDs.reserve(forms.size());
-		collectedLeveledFormIDs.reserve(forms.size());
-
-		for (auto& formData : forms) {
+		detail::for_each_candidate(a_npcData, forms, [&](Forms::Data<Form>& formData) {
 			auto form = formData.form;
 			auto formID = form->GetFormID();
 			if (collectedFormIDs.contains(formID)) {
-				continue;
+				return true;
 			}
 			if constexpr (std::is_same_v<RE::BGSKeyword, Form>) {
-				if (!a_npcData.HasMutuallyExclusiveForm(form) && detail::passed_filters(a_npcData, a_input, formData) && a_npcData.InsertKeyword(form->GetFormEditorID())) {
+				if (!a_npcData.HasMutuallyExclusiveForm(form) && detail::passed_filters(a_npcData, a_input, formData, a_plan) && a_npcData.InsertKeyword(form)) {
 					collectedForms.emplace_back(form);
 					collectedFormIDs.emplace(formID);
 					if (formData.filters.HasLevelFilters()) {
 						collectedLeveledFormIDs.emplace(formID);
 					}
-					if (accumulatedForms) {
-						accumulatedForms->insert({ form, formData.path });
-					}
-					++formData.npcCount;
+					detail::record_form(a_plan, formData);
 				}
 			} else {
-				if (!a_npcData.HasMutuallyExclusiveForm(form) && detail::passed_filters(a_npcData, a_input, formData) && !detail::has_form(npc, form) && collectedFormIDs.emplace(formID).second) {
+				if (!a_npcData.HasMutuallyExclusiveForm(form) && detail::passed_filters(a_npcData, a_input, formData, a_plan) && !detail::has_form(a_npcData, form) && collectedFormIDs.emplace(formID).second) {
 					collectedForms.emplace_back(form);
 					if (formData.filters.HasLevelFilters()) {
 						collectedLeveledFormIDs.emplace(formID);
 					}
-					if (accumulatedForms) {
-						accumulatedForms->insert({ form, formData.path });
-					}
-					++formData.npcCount;
+					detail::record_form(a_plan, formData);
 				}
 			}
-		}
+			return true;
+		});
 
 		if (!collectedForms.empty()) {
 			a_callback(collectedForms);
-			if (!collectedLeveledFormIDs.empty()) {
-				PCLevelMult::Manager::GetSingleton()->InsertDistributedEntry(a_input, Form::FORMTYPE, collectedLeveledFormIDs);
+			a_npcData.ClearVerdicts();
+			if (!collectedLeveledFormIDs.empty() && a_plan) {
+				a_plan->leveledEntries.push_back({ Form::FORMTYPE, collectedLeveledFormIDs });
 			}
 		}
 	}
 #pragma endregion
 
-	using OutfitDistributor = std::function<bool(const NPCData&, RE::BGSOutfit*, bool isFinal)>;
+	using OutfitDistributor = bool (*)(const NPCData&, RE::BGSOutfit*, bool isFinal);
 
 	/// <summary>
-	/// Performs distribution of all configured forms to NPC described with npcData and input.
+	/// Plans distribution of given forms to NPC described with npcData and input.
+	///
+	/// Planning can be repeated with the same plan to add more forms to it, e.g. for linked distribution.
 	/// </summary>
-	/// <param name="npcData">General information about NPC that is being processed.</param>
+	/// <param name="npcData">General information about NPC that is being processed. Planned forms are recorded in it.</param>
 	/// <param name="input">Leveling information about NPC that is being processed.</param>
 	/// <param name="forms">A set of forms that should be distributed to NPC.</param>
-	/// <param name="accumulatedForms">An optional pointer to a set that will accumulate all distributed forms.</param>
+	/// <param name="plan">A plan that planned forms are added to.</param>
+	void Plan(NPCData&, const PCLevelMult::Input&, Forms::DistributionSet& forms, DistributionPlan& plan);
+
+	/// <summary>
+	/// Plans distribution of all configured forms and forms that are linked to them.
+	///
+	/// Planning doesn't modify the game, entries or PCLevelMult::Manager, as changes to them are recorded in the plan and committed by Apply.
+	/// Only thread-safe filter statistics and the plan cache are updated, so different NPCs can be planned in parallel. Non-unique leveled NPCs reuse decisions of equal NPCs through PlanCache.
+	/// </summary>
+	void Plan(NPCData&, const PCLevelMult::Input&, DistributionPlan& plan);
+
+	/// <summary>
+	/// Resolves leveled lists of the plan into items and plans forms that are linked to the resolved items.
+	///
+	/// Leveled lists are resolved by the game, so this must be called on the main thread, after planning and before the plan is applied.
+	/// </summary>
+	/// <param name="npcData">General information about NPC that the plan was made for.</param>
+	/// <param name="input">Leveling information about NPC that the plan was made for.</param>
+	/// <param name="plan">A plan whose leveled lists are resolved.</param>
+	/// <param name="type">Type of linked distribution that forms linked to the resolved items belong to.</param>
+	void ResolveLeveledItems(NPCData&, const PCLevelMult::Input&, DistributionPlan& plan, LinkedDistribution::DistributionType type);
+
+	/// <summary>
+	/// Commits the plan to NPC described with npcData, and records entries that planned it in their statistics and PCLevelMult::Manager.
+	///
+	/// Must be called on the main thread.
+	/// </summary>
+	/// <param name="npcData">General information about NPC that the plan was made for.</param>
+	/// <param name="input">Leveling information about NPC that the plan was made for.</param>
+	/// <param name="plan">A plan to be committed. Items are consumed by it.</param>
 	/// <param name="outfitDistributor">A function to be called to distribute outfits.</param>
-	void Distribute(NPCData&, const PCLevelMult::Input&, Forms::DistributionSet& forms, DistributedForms* accumulatedForms, OutfitDistributor);
+	void Apply(const NPCData&, const PCLevelMult::Input&, DistributionPlan& plan, OutfitDistributor);
 
 	/// <summary>
 	/// Invokes appropriate distribution for given NPC.
@@ -253,5 +508,22 @@ namespace Distribute
 	/// <param name="onlyLeveledEntries"></param>
 	void DistributeOutfits(NPCData& npcData, bool onlyLeveledEntries);
 
+	/// <summary>
+	/// Plans distribution of leveled entries to NPC whose level changed from oldLevel to the one in input.
+	///
+	/// Entries whose Level Filters might give a different verdict at the new level are evaluated first.
+	/// If none of them pass, the rest of leveled entries would see the same NPC as at oldLevel and only leveled items are planned again, as on every level change.
+	/// Otherwise forms that they give might satisfy filters of other entries, so all leveled entries are planned.
+	/// </summary>
+	void PlanLevelChange(NPCData&, const PCLevelMult::Input&, std::uint16_t oldLevel, DistributionPlan& plan);
+
+	/// <summary>
+	/// Performs distribution of leveled entries to NPC described with npcData after its level has changed, see PlanLevelChange.
+	///
+	/// The first level change after NPC was loaded evaluates all leveled entries, like Distribute and DistributeOutfits do.
+	/// </summary>
+	/// <param name="npcData">General information about NPC that is being processed.</param>
+	void DistributeLevelChange(NPCData& npcData);
+
 	void LogDistribution(const DistributedForms& forms, NPCData& npcData, bool append = false);
 }
@@ -0,0 +1,115 @@
+#include "DistributeBatch.h"
+#include "DistributeManager.h"
+#include "Outfits/OutfitManager.h"
+
+#include <execution>
+
+namespace Distribute::Batch
+{
+	namespace
+	{
+		struct Queue
+		{
+			Lock                         lock;
+			std::vector<RE::ActorHandle> actors{};
+			bool                         scheduled{ false };
+		};
+
+#ifdef SPID_BATCH_DISTRIBUTION
+		std::atomic<bool> enabled{ true };
+#else
+		std::atomic<bool> enabled{ false };
+#endif
+		Queue queue{};
+
+		void flush()
+		{
+			std::vector<RE::ActorHandle> actors{};
+			{
+				WriteLocker locker(queue.lock);
+				actors.swap(queue.actors);
+				queue.scheduled = false;
+			}
+
+			std::vector<NPCData> npcs{};
+			npcs.reserve(actors.size());
+
+			// Distribution is done once per NPC, so only the first of actors that share their base is kept.
+			Set<RE::FormID> npcIDs{};
+			for (const auto& handle : actors) {
+				if (const auto actor = handle.get()) {
+					if (const auto npc = actor->GetActorBase(); npc && detail::should_process_NPC(npc) && !npc->HasKeyword(processed) && npcIDs.insert(npc->GetFormID()).second) {
+						npcs.emplace_back(actor.get(), npc);
+					}
+				}
+			}
+
+			if (!npcs.empty()) {
+				Distribute(npcs);
+			}
+		}
+	}
+
+	bool IsEnabled()
+	{
+		return enabled.load(std::memory_order_relaxed);
+	}
+
+	void SetEnabled(bool a_enabled)
+	{
+		enabled.store(a_enabled, std::memory_order_relaxed);
+	}
+
+	void Enqueue(RE::Actor* a_actor)
+	{
+		WriteLocker locker(queue.lock);
+
+		queue.actors.push_back(a_actor->GetHandle());
+		if (!std::exchange(queue.scheduled, true)) {
+			SKSE::GetTaskInterface()->AddTask(flush);
+		}
+	}
+
+	std::vector<DistributionPlan> Plan(std::vector<NPCData>& a_npcs)
+	{
+		std::vector<DistributionPlan> plans(a_npcs.size());
+
+		std::vector<std::size_t> indices(a_npcs.size());
+		std::iota(indices.begin(), indices.end(), static_cast<std::size_t>(0));
+
+		std::for_each(std::execution::par, indices.begin(), indices.end(), [&](const std::size_t a_index) {
+			auto&                    npcData = a_npcs[a_index];
+			const PCLevelMult::Input input{ npcData.GetActor(), npcData.GetNPC(), false };
+
+			Distribute::Plan(npcData, input, plans[a_index]);
+		});
+
+		return plans;
+	}
+
+	void Distribute(std::vector<NPCData>& a_npcs)
+	{
+		Timer planningTimer;
+		Timer applyingTimer;
+
+		planningTimer.start();
+		auto plans = Plan(a_npcs);
+		planningTimer.end();
+
+		applyingTimer.start();
+		for (std::size_t i = 0; i < a_npcs.size(); ++i) {
+			auto& npcData = a_npcs[i];
+
+			const PCLevelMult::Input input{ npcData.GetActor(), npcData.GetNPC(), false };
+
+			ResolveLeveledItems(npcData, input, plans[i], LinkedDistribution::kRegular);
+			Apply(npcData, input, plans[i], Outfits::SetDefaultOutfit);
+			npcData.GetNPC()->AddKeyword(processed);
+
+			LogDistribution(plans[i].distributedForms, npcData);
+		}
+		applyingTimer.end();
+
+		logger::info("Batch of {} NPCs: planned in {}μs, applied in {}μs", a_npcs.size(), planningTimer.duration_μs(), applyingTimer.duration_μs());
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Distribute.h"
+
+/// <summary>
+/// Batched distribution of actors that are loaded together.
+///
+/// Cell loads process dozens of actors back to back. In batch mode they are queued
+/// and distributed at once in a task that runs on the main thread later in the same frame:
+/// plans of all queued NPCs are computed in parallel, and then they are applied one by one in the order in which actors arrived.
+/// </summary>
+namespace Distribute::Batch
+{
+	/// Whether actors are batched instead of being distributed as soon as they are loaded.
+	/// Enabled by default when built with SPID_BATCH_DISTRIBUTION.
+	[[nodiscard]] bool IsEnabled();
+	void               SetEnabled(bool a_enabled);
+
+	/// <summary>
+	/// Queues the actor for distribution in the next batch.
+	///
+	/// The batch is scheduled with the first actor that is queued into it.
+	/// </summary>
+	void Enqueue(RE::Actor* a_actor);
+
+	/// <summary>
+	/// Plans distribution of all configured forms to each of the NPCs in parallel.
+	///
+	/// Only filters are evaluated in parallel. Leveled lists are left in the plans to be resolved on the main thread.
+	/// </summary>
+	/// <returns>Plans in the order of NPCs.</returns>
+	std::vector<DistributionPlan> Plan(std::vector<NPCData>& a_npcs);
+
+	/// <summary>
+	/// Distributes all configured forms to the NPCs.
+	///
+	/// Plans are computed in parallel, and then their leveled lists are resolved and they are applied in the order of NPCs. NPCs are marked as processed.
+	/// Must be called on the main thread, and each NPC in the batch must have a distinct base.
+	/// </summary>
+	void Distribute(std::vector<NPCData>& a_npcs);
+}
@@ -1,5 +1,6 @@
 #include "DistributeManager.h"
 #include "Distribute.h"
+#include "DistributeBatch.h"
 #include "DistributePCLevelMult.h"
 #include "Hooking.h"
 
@@ -34,7 +35,13 @@ namespace Distribute
 			{
 				//	logger::debug("Distribute: ShouldBackgroundClone({})", *(actor->As<RE::Actor>()));
 				if (const auto npc = actor->GetActorBase()) {
-					detail::distribute_on_load(actor, npc);
+					if (Batch::IsEnabled()) {
+						if (detail::should_process_NPC(npc) && !npc->HasKeyword(processed)) {
+							Batch::Enqueue(actor);
+						}
+					} else {
+						detail::distribute_on_load(actor, npc);
+					}
 				}
 				return func(actor);
 			}
@@ -172,6 +179,9 @@ namespace Distribute
 				sums.clear();
 			}
 		});
+
+		LOG_HEADER("FILTERS");
+		Filter::Profile::LogClasses();
 	}
 }
 
@@ -17,8 +17,7 @@ namespace Distribute::PlayerLeveledActor
 		{
 			if (const auto npc = a_actor->GetActorBase(); npc && npc->HasKeyword(processed)) {
 				auto npcData = NPCData(a_actor, npc);
-				Distribute(npcData, true);
-				DistributeOutfits(npcData, true);
+				DistributeLevelChange(npcData);
 			}
 
 			func(a_actor);
@@ -42,17 +41,17 @@ namespace Distribute::PlayerLeveledActor
 				auto input = PCLevelMult::Input{ a_this, npc, true };
 				input.playerID = pcLevelMultManager->GetOldPlayerID();
 
-				pcLevelMultManager->ForEachDistributedEntry(input, false, [&](RE::FormType a_formType, const Set<RE::FormID>& a_formIDSet) {
+				pcLevelMultManager->ForEachDistributedEntry(input, false, [&](RE::FormType a_formType, std::span<const RE::FormID> a_formIDs) {
 					switch (a_formType) {
 					case RE::FormType::Keyword:
 						{
-							const auto keywords = detail::set_to_vec<RE::BGSKeyword>(a_formIDSet);
+							const auto keywords = detail::set_to_vec<RE::BGSKeyword>(a_formIDs);
 							npc->RemoveKeywords(keywords);
 						}
 						break;
 					case RE::FormType::Faction:
 						{
-							const auto factions = detail::set_to_vec<RE::TESFaction>(a_formIDSet);
+							const auto factions = detail::set_to_vec<RE::TESFaction>(a_formIDs);
 							for (auto& factionRank : npc->factions) {
 								if (std::ranges::find(factions, factionRank.faction) != factions.end()) {
 									factionRank.rank = -1;
@@ -62,25 +61,25 @@ namespace Distribute::PlayerLeveledActor
 						break;
 					case RE::FormType::Perk:
 						{
-							const auto perks = detail::set_to_vec<RE::BGSPerk>(a_formIDSet);
+							const auto perks = detail::set_to_vec<RE::BGSPerk>(a_formIDs);
 							npc->RemovePerks(perks);
 						}
 						break;
 					case RE::FormType::Spell:
 						{
-							const auto spells = detail::set_to_vec<RE::SpellItem>(a_formIDSet);
+							const auto spells = detail::set_to_vec<RE::SpellItem>(a_formIDs);
 							npc->GetSpellList()->RemoveSpells(spells);
 						}
 						break;
 					case RE::FormType::LeveledSpell:
 						{
-							const auto spells = detail::set_to_vec<RE::TESLevSpell>(a_formIDSet);
+							const auto spells = detail::set_to_vec<RE::TESLevSpell>(a_formIDs);
 							npc->GetSpellList()->RemoveLevSpells(spells);
 						}
 						break;
 					case RE::FormType::Shout:
 						{
-							const auto shouts = detail::set_to_vec<RE::TESShout>(a_formIDSet);
+							const auto shouts = detail::set_to_vec<RE::TESShout>(a_formIDs);
 							npc->GetSpellList()->RemoveShouts(shouts);
 						}
 						break;
@@ -105,23 +104,26 @@ namespace Distribute::PlayerLeveledActor
 				const auto pcLevelMultManager = PCLevelMult::Manager::GetSingleton();
 				const auto input = PCLevelMult::Input{ a_this, npc, true };
 
+				// Level of the save might differ from the one that NPC was last distributed at, so the next level change evaluates all entries.
+				pcLevelMultManager->ClearDistributedLevel(input);
+
 				if (!pcLevelMultManager->FindDistributedEntry(input)) {
 					//start distribution of leveled entries for first time
 					auto npcData = NPCData(a_this, npc);
 					Distribute(npcData, true);
 				} else {
 					//handle redistribution
-					pcLevelMultManager->ForEachDistributedEntry(input, true, [&](RE::FormType a_formType, const Set<RE::FormID>& a_formIDSet) {
+					pcLevelMultManager->ForEachDistributedEntry(input, true, [&](RE::FormType a_formType, std::span<const RE::FormID> a_formIDs) {
 						switch (a_formType) {
 						case RE::FormType::Keyword:
 							{
-								const auto keywords = detail::set_to_vec<RE::BGSKeyword>(a_formIDSet);
+								const auto keywords = detail::set_to_vec<RE::BGSKeyword>(a_formIDs);
 								npc->AddKeywords(keywords);
 							}
 							break;
 						case RE::FormType::Faction:
 							{
-								const auto factions = detail::set_to_vec<RE::TESFaction>(a_formIDSet);
+								const auto factions = detail::set_to_vec<RE::TESFaction>(a_formIDs);
 								for (auto& factionRank : npc->factions) {
 									if (std::ranges::find(factions, factionRank.faction) != factions.end()) {
 										factionRank.rank = 1;
@@ -131,25 +133,25 @@ namespace Distribute::PlayerLeveledActor
 							break;
 						case RE::FormType::Perk:
 							{
-								const auto perks = detail::set_to_vec<RE::BGSPerk>(a_formIDSet);
+								const auto perks = detail::set_to_vec<RE::BGSPerk>(a_formIDs);
 								npc->AddPerks(perks, 1);
 							}
 							break;
 						case RE::FormType::Spell:
 							{
-								const auto spells = detail::set_to_vec<RE::SpellItem>(a_formIDSet);
+								const auto spells = detail::set_to_vec<RE::SpellItem>(a_formIDs);
 								npc->GetSpellList()->AddSpells(spells);
 							}
 							break;
 						case RE::FormType::LeveledSpell:
 							{
-								const auto spells = detail::set_to_vec<RE::TESLevSpell>(a_formIDSet);
+								const auto spells = detail::set_to_vec<RE::TESLevSpell>(a_formIDs);
 								npc->GetSpellList()->AddLevSpells(spells);
 							}
 							break;
 						case RE::FormType::Shout:
 							{
-								const auto shouts = detail::set_to_vec<RE::TESShout>(a_formIDSet);
+								const auto shouts = detail::set_to_vec<RE::TESShout>(a_formIDs);
 								npc->GetSpellList()->AddShouts(shouts);
 							}
 							break;
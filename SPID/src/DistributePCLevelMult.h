@@ -5,11 +5,11 @@ namespace Distribute::PlayerLeveledActor
 	namespace detail
 	{
 		template <class Form>
-		auto set_to_vec(const Set<RE::FormID>& a_formIDSet) -> std::vector<Form*>
+		auto set_to_vec(std::span<const RE::FormID> a_formIDs) -> std::vector<Form*>
 		{
 			std::vector<Form*> forms{};
-			forms.reserve(a_formIDSet.size());
-			for (auto& formID : a_formIDSet) {
+			forms.reserve(a_formIDs.size());
+			for (auto& formID : a_formIDs) {
 				if (auto* form = RE::TESForm::LookupByID<Form>(formID)) {
 					forms.emplace_back(form);
 				}
@@ -0,0 +1,113 @@
+#include "FilterJIT.h"
+
+#ifdef SPID_FILTER_JIT
+namespace Filter::JIT
+{
+	namespace detail
+	{
+		/// Upper bound of code size generated for a single instruction.
+		constexpr std::size_t maxInstructionSize = 48;
+		/// Size of the code that returns result.
+		constexpr std::size_t epilogueSize = 16;
+		/// Each Predicate starts at an aligned address.
+		constexpr std::size_t alignment = 16;
+
+		bool is_feature_instruction(const Instruction& a_instruction)
+		{
+			switch (a_instruction.op) {
+			case Opcode::kFail:
+			case Opcode::kTraits:
+			case Opcode::kLevel:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		void generate(Xbyak::CodeGenerator& a_code, std::span<const Instruction> a_instructions)
+		{
+			using namespace Xbyak::util;
+			using Features = NPC::Features;
+
+			// The only argument is a pointer to Features.
+#	ifdef _WIN32
+			const auto& features = rcx;
+#	else
+			const auto& features = rdi;
+#	endif
+
+			Xbyak::Label fail;
+
+			const auto check_range = [&](std::uint32_t a_min, std::uint32_t a_max) {
+				a_code.cmp(eax, a_min);
+				a_code.jb(fail, Xbyak::CodeGenerator::T_NEAR);
+				a_code.cmp(eax, a_max);
+				a_code.ja(fail, Xbyak::CodeGenerator::T_NEAR);
+			};
+
+			for (const auto& [op, arg, count, operand] : a_instructions) {
+				switch (op) {
+				case Opcode::kFail:
+					a_code.jmp(fail, Xbyak::CodeGenerator::T_NEAR);
+					break;
+				case Opcode::kTraits:
+					a_code.movzx(eax, byte[features + offsetof(Features, traits)]);
+					a_code.and_(eax, operand & 0xFF);
+					a_code.cmp(eax, operand >> 8);
+					a_code.jne(fail, Xbyak::CodeGenerator::T_NEAR);
+					break;
+				case Opcode::kLevel:
+					a_code.movzx(eax, word[features + offsetof(Features, level)]);
+					check_range(operand & 0xFFFF, operand >> 16);
+					break;
+				default:
+					break;
+				}
+			}
+
+			a_code.mov(eax, 1);
+			a_code.ret();
+			a_code.L(fail);
+			a_code.xor_(eax, eax);
+			a_code.ret();
+		}
+	}
+
+	std::size_t Compiler::Compile(std::span<const Instruction> a_instructions, Predicate& a_predicate)
+	{
+		const auto prefix = std::ranges::find_if_not(a_instructions, detail::is_feature_instruction);
+		const auto count = static_cast<std::size_t>(std::distance(a_instructions.begin(), prefix));
+
+		if (count == 0) {
+			return 0;
+		}
+
+		const auto maxSize = detail::alignment + count * detail::maxInstructionSize + detail::epilogueSize;
+		if (maxSize > blockSize) {
+			return 0;  // Such a huge Program is better left to the interpreter.
+		}
+
+		if (blocks.empty() || blocks.back()->getSize() + maxSize > blockSize) {
+			blocks.push_back(std::make_unique<Xbyak::CodeGenerator>(blockSize));
+		}
+
+		auto& code = *blocks.back();
+		code.align(detail::alignment);
+
+		const auto entry = code.getCurr();
+		detail::generate(code, a_instructions.first(count));
+
+		a_predicate = reinterpret_cast<Predicate>(entry);
+		return count;
+	}
+
+	std::size_t Compiler::GetSize() const
+	{
+		std::size_t size = 0;
+		for (const auto& block : blocks) {
+			size += block->getSize();
+		}
+		return size;
+	}
+}
+#endif
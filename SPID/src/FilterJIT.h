@@ -0,0 +1,44 @@
+#pragma once
+
+#include "FilterProgram.h"
+
+#ifdef SPID_FILTER_JIT
+/// JIT compiles feature checks of filter Programs (traits and actor level) into native x86-64 code.
+///
+/// This is an optional mode for very large configs, enabled with ENABLE_FILTER_JIT CMake option.
+/// Compiled code only replaces a prefix of Program's instructions that depend solely on NPC::Features,
+/// the rest of the Program (including SIMD skill checks) is still interpreted,
+/// and the interpreter remains the reference for compiled code.
+namespace Filter::JIT
+{
+	using Predicate = Program::Predicate;
+
+	/// Total number of entries that makes compiling filters worth it.
+	/// Smaller configs are evaluated faster than compiled code can pay off its memory and compilation time.
+	inline constexpr std::size_t minEntries = 2000;
+
+	/// <summary>
+	/// Generates native code of Programs into executable memory blocks.
+	///
+	/// Compiled code lives as long as the Compiler, so Programs must not outlive the Compiler that compiled them.
+	/// </summary>
+	class Compiler
+	{
+	public:
+		/// Compiles leading feature instructions of the Program.
+		/// <returns>Number of instructions that were compiled into a_predicate.</returns>
+		std::size_t Compile(std::span<const Instruction> a_instructions, Predicate& a_predicate);
+
+		/// Total size of generated code in bytes.
+		[[nodiscard]] std::size_t GetSize() const;
+
+	private:
+		static constexpr std::size_t blockSize = 64 * 1024;
+
+		std::vector<std::unique_ptr<Xbyak::CodeGenerator>> blocks{};
+	};
+
+	/// The compiler that owns code of all Programs created during lookup.
+	inline Compiler compiler{};
+}
+#endif
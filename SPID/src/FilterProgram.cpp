@@ -0,0 +1,359 @@
+#include "FilterProgram.h"
+#include "FilterJIT.h"
+
+namespace Filter
+{
+	TraitMask::TraitMask(const Traits& a_traits)
+	{
+		const auto add = [&](NPC::TraitFlags a_flag, const std::optional<bool>& a_value) {
+			if (a_value) {
+				care |= a_flag;
+				if (*a_value) {
+					want |= a_flag;
+				}
+			}
+		};
+
+		if (a_traits.sex) {
+			switch (*a_traits.sex) {
+			case RE::SEX::kMale:
+				add(NPC::kFemale, false);
+				break;
+			case RE::SEX::kFemale:
+				add(NPC::kFemale, true);
+				break;
+			default:
+				// NPCs are always either male or female.
+				add(NPC::kNever, true);
+				break;
+			}
+		}
+
+		add(NPC::kUnique, a_traits.unique);
+		add(NPC::kSummonable, a_traits.summonable);
+		add(NPC::kChild, a_traits.child);
+		add(NPC::kLeveled, a_traits.leveled);
+		add(NPC::kTeammate, a_traits.teammate);
+		add(NPC::kDead, a_traits.startsDead);
+	}
+
+	SkillRanges::SkillRanges()
+	{
+		max.fill(std::numeric_limits<std::uint8_t>::max());
+	}
+
+	SkillRanges::SkillRanges(const std::vector<SkillLevel>& a_skills) :
+		SkillRanges()
+	{
+		// Several filters of the same skill must all pass, so their ranges are intersected.
+		for (const auto& [skill, range] : a_skills) {
+			if (skill < NPC::Features::skillCount) {
+				min[skill] = std::max(min[skill], range.min);
+				max[skill] = std::min(max[skill], range.max);
+			}
+		}
+	}
+
+	bool SkillRanges::Contains(const NPC::Features::Skills& a_values) const
+	{
+		static_assert(NPC::Features::skillStride % 16 == 0);
+
+		auto inRange = _mm_set1_epi8(-1);
+		for (std::size_t i = 0; i < NPC::Features::skillStride; i += 16) {
+			const auto values = _mm_load_si128(reinterpret_cast<const __m128i*>(a_values.data() + i));
+			const auto lower = _mm_load_si128(reinterpret_cast<const __m128i*>(min.data() + i));
+			const auto upper = _mm_load_si128(reinterpret_cast<const __m128i*>(max.data() + i));
+
+			// SSE2 has no unsigned byte comparison, but value >= min exactly when max(value, min) == value.
+			const auto aboveMin = _mm_cmpeq_epi8(_mm_max_epu8(values, lower), values);
+			const auto belowMax = _mm_cmpeq_epi8(_mm_min_epu8(values, upper), values);
+			inRange = _mm_and_si128(inRange, _mm_and_si128(aboveMin, belowMax));
+		}
+		return _mm_movemask_epi8(inRange) == 0xFFFF;
+	}
+
+	Profile::Profile(std::size_t a_size) :
+		size(a_size)
+	{
+		assert(a_size <= maxInstructions);
+		// Until the order is picked, instructions are evaluated in the order they were emitted.
+		for (std::size_t i = 0; i < size; ++i) {
+			order |= static_cast<Order>(i) << (i * 4);
+		}
+	}
+
+	void Profile::Counter::Record(bool a_passed, std::uint64_t a_nanoseconds)
+	{
+		runs.fetch_add(1, std::memory_order_relaxed);
+		if (a_passed) {
+			passes.fetch_add(1, std::memory_order_relaxed);
+		}
+		nanoseconds.fetch_add(a_nanoseconds, std::memory_order_relaxed);
+	}
+
+	void Profile::Record(std::size_t a_index, Opcode a_op, bool a_passed, std::uint64_t a_nanoseconds)
+	{
+		counters[a_index].Record(a_passed, a_nanoseconds);
+		classes[static_cast<std::size_t>(a_op)].Record(a_passed, a_nanoseconds);
+	}
+
+	void Profile::Finish()
+	{
+		// Only the thread that completes the last sample picks the order.
+		if (evaluations.fetch_add(1, std::memory_order_relaxed) + 1 != samples) {
+			return;
+		}
+
+		std::array<double, maxInstructions> costs{};
+		for (std::size_t i = 0; i < size; ++i) {
+			const auto& counter = counters[i];
+
+			const auto runs = static_cast<double>(counter.runs.load(std::memory_order_relaxed));
+			const auto rejected = 1.0 - counter.passes.load(std::memory_order_relaxed) / runs;
+			const auto time = counter.nanoseconds.load(std::memory_order_relaxed) / runs;
+
+			// Instructions that never reject anything go last.
+			costs[i] = rejected > 0 ? time / rejected : std::numeric_limits<double>::infinity();
+		}
+
+		std::array<std::uint8_t, maxInstructions> indices{};
+		std::iota(indices.begin(), indices.begin() + size, static_cast<std::uint8_t>(0));
+		// Stable sort keeps the emitted order of instructions with equal costs.
+		std::stable_sort(indices.begin(), indices.begin() + size, [&](const auto a_lhs, const auto a_rhs) { return costs[a_lhs] < costs[a_rhs]; });
+
+		Order result = 0;
+		for (std::size_t i = 0; i < size; ++i) {
+			result |= static_cast<Order>(indices[i]) << (i * 4);
+		}
+
+		order = result;
+		ready.store(true, std::memory_order_release);
+	}
+
+	void Profile::LogClasses()
+	{
+		static constexpr std::array<std::string_view, static_cast<std::size_t>(Opcode::kTotal)> names{
+			"Fail", "Traits", "Level", "Skill Levels", "Skill Weights", "Strings (ALL)", "Strings (NOT)", "Strings (MATCH)", "Strings (ANY)", "Forms (ALL)", "Forms (NOT)", "Forms (MATCH)"
+		};
+
+		for (std::size_t i = 0; i < classes.size(); ++i) {
+			const auto runs = classes[i].runs.load(std::memory_order_relaxed);
+			if (runs == 0) {
+				continue;
+			}
+			const auto passes = classes[i].passes.load(std::memory_order_relaxed);
+			const auto nanoseconds = classes[i].nanoseconds.load(std::memory_order_relaxed);
+			logger::info("\t{}: {} checks, {:.1f}% passed, {}ns per check", names[i], runs, 100.0 * passes / runs, nanoseconds / runs);
+		}
+	}
+
+	Program::Program(const Filters<Atom>& a_strings, const PatternVec& a_patterns, const FormFilters& a_forms, const LevelFilters& a_levels, const TraitMask& a_traits)
+	{
+		emit_traits(a_traits);
+		emit_levels(a_levels);
+
+		emit_values(Opcode::kStringsAll, a_strings.ALL);
+		emit_values(Opcode::kStringsNone, a_strings.NOT);
+		emit_values(Opcode::kStringsAny, a_strings.MATCH);
+		emit_values(Opcode::kPatternsAny, a_patterns);
+
+		emit_forms(Opcode::kFormsAll, a_forms.ALL);
+		emit_forms(Opcode::kFormsNone, a_forms.NOT);
+		emit_forms(Opcode::kFormsAny, a_forms.MATCH);
+
+		reset_profile(code.size());
+	}
+
+	void Program::reset_profile(std::size_t a_size)
+	{
+		if (a_size > 1) {
+			profile = std::make_shared<Profile>(a_size);
+		} else {
+			profile.reset();
+		}
+	}
+
+	void Program::emit_traits(const TraitMask& a_traits)
+	{
+		if (a_traits.want & NPC::kNever) {
+			code.push_back({ Opcode::kFail });
+		} else if (a_traits.care != NPC::kNone) {
+			code.push_back({ Opcode::kTraits, 0, 0, a_traits.care | static_cast<std::uint32_t>(a_traits.want) << 8 });
+		}
+	}
+
+	void Program::emit_levels(const LevelFilters& a_levels)
+	{
+		const auto& [actorLevel, skillLevels, skillWeights] = a_levels;
+
+		if (actorLevel.min > std::numeric_limits<std::uint16_t>::min() || actorLevel.max < std::numeric_limits<std::uint16_t>::max()) {
+			code.push_back({ Opcode::kLevel, 0, 0, actorLevel.min | static_cast<std::uint32_t>(actorLevel.max) << 16 });
+		}
+
+		emit_skills(Opcode::kSkillLevels, skillLevels);
+		emit_skills(Opcode::kSkillWeights, skillWeights);
+	}
+
+	void Program::emit_skills(Opcode a_op, const std::vector<SkillLevel>& a_skills)
+	{
+		static const SkillRanges unbounded{};
+
+		const SkillRanges ranges{ a_skills };
+
+		// Ranges that include all values can't fail.
+		if (ranges.min == unbounded.min && ranges.max == unbounded.max) {
+			return;
+		}
+		code.push_back({ a_op, 0, 0, static_cast<std::uint32_t>(skills.size()) });
+		skills.push_back(ranges);
+	}
+
+	void Program::emit_values(Opcode a_op, std::span<const std::uint32_t> a_values)
+	{
+		if (a_values.empty()) {
+			return;
+		}
+		code.push_back({ a_op, 0, static_cast<std::uint16_t>(a_values.size()), static_cast<std::uint32_t>(values.size()) });
+		values.insert(values.end(), a_values.begin(), a_values.end());
+	}
+
+	void Program::emit_forms(Opcode a_op, const FormVec& a_forms)
+	{
+		if (a_forms.empty()) {
+			return;
+		}
+		code.push_back({ a_op, 0, static_cast<std::uint16_t>(a_forms.size()), static_cast<std::uint32_t>(forms.size()) });
+		forms.insert(forms.end(), a_forms.begin(), a_forms.end());
+	}
+
+	bool Program::operator==(const Program& a_rhs) const
+	{
+		return code == a_rhs.code && values == a_rhs.values && forms == a_rhs.forms && skills == a_rhs.skills;
+	}
+
+	std::uint64_t Program::Hash() const
+	{
+		using ankerl::unordered_dense::detail::wyhash::hash;
+
+		auto result = hash(code.data(), code.size() * sizeof(Instruction));
+		result ^= hash(values.data(), values.size() * sizeof(std::uint32_t)) * 0x9E3779B97F4A7C15ull;
+		result ^= hash(skills.data(), skills.size() * sizeof(SkillRanges)) * 0xC2B2AE3D27D4EB4Full;
+		for (const auto& formOrMod : forms) {
+			const auto pointer = std::visit([](const auto* a_ptr) { return reinterpret_cast<std::uintptr_t>(a_ptr); }, formOrMod);
+			result = hash(result ^ pointer);
+		}
+		return result;
+	}
+
+	ProgramTable::ID ProgramTable::Intern(const Program& a_program)
+	{
+		return programs.try_emplace(a_program, static_cast<ID>(programs.size())).first->second;
+	}
+
+	bool Program::evaluate_feature(const Instruction& a_instruction, const NPC::Features& a_features)
+	{
+		const auto& [op, arg, count, operand] = a_instruction;
+
+		switch (op) {
+		case Opcode::kTraits:
+			return (a_features.traits & operand & 0xFF) == (operand >> 8);
+		case Opcode::kLevel:
+			return a_features.level >= (operand & 0xFFFF) && a_features.level <= (operand >> 16);
+		default:
+			return false;
+		}
+	}
+
+	bool Program::EvaluateFeatures(std::span<const Instruction> a_instructions, const NPC::Features& a_features)
+	{
+		return std::ranges::all_of(a_instructions, [&](const auto& a_instruction) { return evaluate_feature(a_instruction, a_features); });
+	}
+
+#ifdef SPID_FILTER_JIT
+	void Program::Compile(JIT::Compiler& a_compiler)
+	{
+		nativeCount = a_compiler.Compile(code, native);
+		// Native code always runs first, so only the rest of instructions is profiled.
+		reset_profile(code.size() - nativeCount);
+	}
+#endif
+
+	bool Program::Evaluate(const NPC::Data& a_npcData) const
+	{
+		const auto& features = a_npcData.GetFeatures();
+
+		std::span<const Instruction> instructions{ code };
+
+#ifdef SPID_FILTER_JIT
+		if (native) {
+			if (!native(&features)) {
+				return false;
+			}
+			instructions = instructions.subspan(nativeCount);
+		}
+#endif
+
+		if (profile) {
+			if (profile->IsProfiling()) {
+				return evaluate_profiled(instructions, a_npcData, features);
+			}
+
+			auto order = profile->GetOrder();
+			for (std::size_t i = 0; i < instructions.size(); ++i, order >>= 4) {
+				if (!evaluate(instructions[order & 0xF], a_npcData, features)) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		return std::ranges::all_of(instructions, [&](const auto& a_instruction) { return evaluate(a_instruction, a_npcData, features); });
+	}
+
+	bool Program::evaluate_profiled(std::span<const Instruction> a_instructions, const NPC::Data& a_npcData, const NPC::Features& a_features) const
+	{
+		using clock = std::chrono::steady_clock;
+
+		// All instructions are evaluated, so that each of them is measured on all NPCs and not only on those that passed the previous ones.
+		bool passed = true;
+		for (std::size_t i = 0; i < a_instructions.size(); ++i) {
+			const auto start = clock::now();
+			const auto result = evaluate(a_instructions[i], a_npcData, a_features);
+			const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+
+			profile->Record(i, a_instructions[i].op, result, static_cast<std::uint64_t>(elapsed));
+			passed &= result;
+		}
+		profile->Finish();
+
+		return passed;
+	}
+
+	bool Program::evaluate(const Instruction& a_instruction, const NPC::Data& a_npcData, const NPC::Features& a_features) const
+	{
+		const auto& [op, arg, count, operand] = a_instruction;
+
+		switch (op) {
+		case Opcode::kSkillLevels:
+			return skills[operand].Contains(a_features.skills);
+		case Opcode::kSkillWeights:
+			return !a_features.hasClass || skills[operand].Contains(a_features.skillWeights);
+		case Opcode::kStringsAll:
+			return a_npcData.HasStringFilter({ values.data() + operand, count }, true);
+		case Opcode::kStringsNone:
+			return !a_npcData.HasStringFilter({ values.data() + operand, count });
+		case Opcode::kStringsAny:
+			return a_npcData.HasStringFilter({ values.data() + operand, count });
+		case Opcode::kPatternsAny:
+			return a_npcData.ContainsStringFilter({ values.data() + operand, count });
+		case Opcode::kFormsAll:
+			return a_npcData.HasFormFilter({ forms.data() + operand, count }, true);
+		case Opcode::kFormsNone:
+			return !a_npcData.HasFormFilter({ forms.data() + operand, count });
+		case Opcode::kFormsAny:
+			return a_npcData.HasFormFilter({ forms.data() + operand, count });
+		default:
+			return evaluate_feature(a_instruction, a_features);
+		}
+	}
+}
@@ -0,0 +1,230 @@
+#pragma once
+
+#include "LookupNPC.h"
+
+namespace Filter
+{
+	namespace JIT
+	{
+		class Compiler;
+	}
+
+	enum class Opcode : std::uint8_t
+	{
+		kFail = 0,     // Always fails. Used for filters that can never pass.
+		kTraits,       // (NPC traits & care) == want. operand: care | want << 8
+		kLevel,        // min <= NPC level <= max. operand: min | max << 16
+		kSkillLevels,   // all skills are within SkillRanges. operand: index of SkillRanges
+		kSkillWeights,  // all weights are within SkillRanges or NPC has no class. operand: index of SkillRanges
+		kStringsAll,   // NPC has all Atoms. operand: offset in values, count: number of Atoms
+		kStringsNone,  // NPC has none of the Atoms. operand: offset in values, count: number of Atoms
+		kStringsAny,   // NPC has any of the Atoms. operand: offset in values, count: number of Atoms
+		kPatternsAny,  // NPC has any of the Patterns. operand: offset in values, count: number of Patterns
+		kFormsAll,     // NPC has all of the forms. operand: offset in forms, count: number of forms
+		kFormsNone,    // NPC has none of the forms. operand: offset in forms, count: number of forms
+		kFormsAny,     // NPC has any of the forms. operand: offset in forms, count: number of forms
+
+		kTotal
+	};
+
+	/// <summary>
+	/// Trait Filters converted into TraitFlags that NPC must have (want) among the flags that filters care about.
+	///
+	/// All traits are checked at once with (NPC traits & care) == want.
+	/// </summary>
+	struct TraitMask
+	{
+		TraitMask() = default;
+		explicit TraitMask(const Traits& a_traits);
+
+		std::uint8_t care{ NPC::kNone };
+		std::uint8_t want{ NPC::kNone };
+
+		[[nodiscard]] bool Matches(std::uint8_t a_traits) const { return (a_traits & care) == want; }
+	};
+
+	/// <summary>
+	/// Skill Level or Skill Weight filters of an entry as dense ranges of all skills.
+	///
+	/// Skills that are not filtered span the whole range, so that all of them are checked at once with SIMD.
+	/// </summary>
+	struct SkillRanges
+	{
+		SkillRanges();
+		explicit SkillRanges(const std::vector<SkillLevel>& a_skills);
+
+		alignas(16) NPC::Features::Skills min{};
+		alignas(16) NPC::Features::Skills max{};
+
+		[[nodiscard]] bool Contains(const NPC::Features::Skills& a_values) const;
+
+		bool operator==(const SkillRanges&) const = default;
+	};
+
+	/// A single check of a filter Program.
+	struct Instruction
+	{
+		Opcode        op{ Opcode::kFail };
+		std::uint8_t  arg{ 0 };
+		std::uint16_t count{ 0 };
+		std::uint32_t operand{ 0 };
+
+		bool operator==(const Instruction&) const = default;
+	};
+	static_assert(sizeof(Instruction) == 8);
+
+	/// <summary>
+	/// Runtime statistics of Program's instructions, which are used to pick the order of their evaluation.
+	///
+	/// The first evaluations of a Program are profiled: all of its instructions are evaluated and timed.
+	/// Once enough samples are collected, instructions are ordered by the expected cost of rejecting an NPC,
+	/// that is by the average time of an instruction divided by the share of NPCs that it rejects.
+	/// Profile is shared by all copies of a Program and is updated from multiple threads.
+	/// </summary>
+	class Profile
+	{
+	public:
+		/// Number of profiled evaluations after which the order is picked.
+		static constexpr std::uint32_t samples = 128;
+
+		/// Order stores an index of each instruction in 4 bits.
+		static constexpr std::size_t maxInstructions = 16;
+
+		/// Indices of instructions in the order of evaluation, 4 bits each, starting with the lowest bits.
+		using Order = std::uint64_t;
+
+		explicit Profile(std::size_t a_size);
+
+		[[nodiscard]] bool  IsProfiling() const { return !ready.load(std::memory_order_acquire); }
+		[[nodiscard]] Order GetOrder() const { return order; }
+
+		/// Records a single evaluation of the instruction at given index.
+		void Record(std::size_t a_index, Opcode a_op, bool a_passed, std::uint64_t a_nanoseconds);
+
+		/// Finishes a profiled evaluation of the Program and picks the order once enough samples were collected.
+		void Finish();
+
+		/// Logs statistics of each kind of instruction collected across all Programs.
+		static void LogClasses();
+
+	private:
+		struct Counter
+		{
+			std::atomic<std::uint32_t> runs{ 0 };
+			std::atomic<std::uint32_t> passes{ 0 };
+			std::atomic<std::uint64_t> nanoseconds{ 0 };
+
+			void Record(bool a_passed, std::uint64_t a_nanoseconds);
+		};
+
+		std::size_t                           size;
+		std::array<Counter, maxInstructions>  counters{};
+		std::atomic<std::uint32_t>            evaluations{ 0 };
+		Order                                 order{ 0 };  // Written once before ready is set.
+		std::atomic<bool>                     ready{ false };
+
+		static inline std::array<Counter, static_cast<std::size_t>(Opcode::kTotal)> classes{};
+	};
+
+	/// <summary>
+	/// Filters of a single entry compiled into a flat list of Instructions.
+	///
+	/// Program is evaluated against NPC's Features and passes only if all of its instructions pass.
+	/// Instructions are emitted from the cheapest to the most expensive, and after the first evaluations
+	/// they are reordered according to their Profile, so that most NPCs are rejected early.
+	/// Chance is not part of the Program, since it must be rolled before anything else.
+	///
+	/// With SPID_FILTER_JIT the leading instructions that only check Features can be compiled into native code.
+	/// </summary>
+	class Program
+	{
+	public:
+		/// Native code that evaluates leading feature instructions of the Program.
+		using Predicate = bool (*)(const NPC::Features*);
+
+		Program() = default;
+		Program(const Filters<Atom>& a_strings, const PatternVec& a_patterns, const FormFilters& a_forms, const LevelFilters& a_levels, const TraitMask& a_traits);
+
+		[[nodiscard]] bool Evaluate(const NPC::Data& a_npcData) const;
+
+		/// Interprets instructions that only check Features (as found in the prefix of a Program).
+		/// This is the reference for native code. Instructions that need more than Features always fail.
+		[[nodiscard]] static bool EvaluateFeatures(std::span<const Instruction> a_instructions, const NPC::Features& a_features);
+
+#ifdef SPID_FILTER_JIT
+		/// Replaces leading feature instructions with native code generated by the compiler.
+		/// The Program must not outlive the compiler.
+		void Compile(JIT::Compiler& a_compiler);
+
+		[[nodiscard]] bool IsCompiled() const { return native != nullptr; }
+#endif
+
+		[[nodiscard]] std::span<const Instruction> GetInstructions() const { return code; }
+
+		[[nodiscard]] const Profile* GetProfile() const { return profile.get(); }
+
+		[[nodiscard]] bool empty() const { return code.empty(); }
+
+		/// Programs are equal when they perform the same checks, regardless of whether they were compiled.
+		bool operator==(const Program& a_rhs) const;
+
+		[[nodiscard]] std::uint64_t Hash() const;
+
+	private:
+		std::vector<Instruction>   code{};
+		std::vector<std::uint32_t> values{};  // Atoms and Patterns referenced by instructions.
+		FormVec                    forms{};   // Forms referenced by instructions.
+		std::vector<SkillRanges>   skills{};  // SkillRanges referenced by instructions.
+
+		std::shared_ptr<Profile> profile{};  // Profile of interpreted instructions. Programs with a single instruction have nothing to reorder.
+
+#ifdef SPID_FILTER_JIT
+		Predicate   native{ nullptr };
+		std::size_t nativeCount{ 0 };  // Number of leading instructions evaluated by native code.
+#endif
+
+		void emit_traits(const TraitMask& a_traits);
+		void emit_levels(const LevelFilters& a_levels);
+		void emit_skills(Opcode a_op, const std::vector<SkillLevel>& a_skills);
+		void emit_values(Opcode a_op, std::span<const std::uint32_t> a_values);
+		void emit_forms(Opcode a_op, const FormVec& a_forms);
+
+		void reset_profile(std::size_t a_size);
+
+		[[nodiscard]] bool evaluate(const Instruction& a_instruction, const NPC::Data& a_npcData, const NPC::Features& a_features) const;
+		[[nodiscard]] bool evaluate_profiled(std::span<const Instruction> a_instructions, const NPC::Data& a_npcData, const NPC::Features& a_features) const;
+
+		static bool evaluate_feature(const Instruction& a_instruction, const NPC::Features& a_features);
+	};
+
+	/// <summary>
+	/// A table that assigns the same ID to all equal Programs.
+	///
+	/// Many entries share identical filters, so their Programs are interned
+	/// and the result of each distinct Program can be computed once per NPC.
+	/// The table is populated during lookup and doesn't synchronize access to itself.
+	/// </summary>
+	class ProgramTable
+	{
+	public:
+		using ID = std::uint32_t;
+
+		/// Returns an ID for the given Program, assigning a new one if no equal Program was interned yet.
+		ID Intern(const Program& a_program);
+
+		[[nodiscard]] std::size_t GetSize() const { return programs.size(); }
+
+	private:
+		struct hash
+		{
+			using is_avalanching = void;  // mark class as high quality avalanching hash
+
+			[[nodiscard]] std::uint64_t operator()(const Program& a_program) const noexcept { return a_program.Hash(); }
+		};
+
+		ankerl::unordered_dense::map<Program, ID, hash> programs{};
+	};
+
+	/// The table that is used by Filter Data.
+	inline ProgramTable programs{};
+}
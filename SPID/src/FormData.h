@@ -1,7 +1,11 @@
 #pragma once
 
+#include "CandidateIndex.h"
+#include "FilterJIT.h"
 #include "LookupConfigs.h"
 #include "LookupFilters.h"
+#include "Paths.h"
+#include "SmallVector.h"
 
 namespace Forms
 {
@@ -369,17 +373,69 @@ namespace Forms
 		IndexOrCount idxOrCount{ RandomCount(1, 1) };
 		FilterData   filters{};
 
-		Path          path{};
-		std::uint32_t npcCount{ 0 };
+		Paths::ID     path{ Paths::none };
+		std::uint32_t npcCount{ 0 };  // Updated when a plan that the entry gave forms to is applied.
 
 		bool operator==(const Data& a_rhs) const;
 	};
 
+	/// <summary>
+	/// A list of entries for a single form type, in the order in which they should be distributed.
+	///
+	/// Along with entries it stores an index of candidates that is built once lookup is finished.
+	/// Lists that never had the index built (e.g. linked forms) are processed by checking every entry.
+	/// </summary>
 	template <class Form>
-	using DataVec = std::vector<Data<Form>>;
+	struct DataVec : std::vector<Data<Form>>
+	{
+		using std::vector<Data<Form>>::vector;
+
+		Candidates::Index candidates{};
+	};
+
+	/// A form that was distributed and the config that it was distributed by.
+	struct DistributedForm
+	{
+		RE::TESForm* form{ nullptr };
+		Paths::ID    path{ Paths::none };
+
+		auto operator<=>(const DistributedForm&) const = default;
+	};
+
+	/// <summary>
+	/// A sorted set of distributed forms.
+	///
+	/// Typical NPCs receive only a handful of forms, so they are kept inline and the set doesn't allocate unless it grows large.
+	/// </summary>
+	class DistributedForms
+	{
+	public:
+		static constexpr std::size_t inlineCapacity = 16;
 
-	using DistributedForm = std::pair<RE::TESForm*, const Path>;
-	using DistributedForms = std::set<DistributedForm>;
+		/// Inserts the form unless it is already in the set.
+		/// <returns>True if the form was inserted.</returns>
+		bool insert(const DistributedForm& a_form)
+		{
+			const auto it = std::lower_bound(forms.begin(), forms.end(), a_form);
+			if (it != forms.end() && *it == a_form) {
+				return false;
+			}
+			forms.insert(it, a_form);
+			return true;
+		}
+
+		[[nodiscard]] bool        empty() const { return forms.empty(); }
+		[[nodiscard]] std::size_t size() const { return forms.size(); }
+
+		/// Whether the set still keeps its forms inline.
+		[[nodiscard]] bool IsInline() const { return forms.IsInline(); }
+
+		[[nodiscard]] const DistributedForm* begin() const { return forms.begin(); }
+		[[nodiscard]] const DistributedForm* end() const { return forms.end(); }
+
+	private:
+		SmallVector<DistributedForm, inlineCapacity> forms{};
+	};
 
 	/// <summary>
 	/// A set of distributable forms that should be processed.
@@ -437,17 +493,38 @@ namespace Forms
 		DataVec<Form>& GetForms(bool a_onlyLevelEntries);
 		DataVec<Form>& GetForms();
 
+		/// <summary>
+		/// Returns entries with Level Filters whose verdict might differ between the two levels of an NPC.
+		///
+		/// These are entries with an Actor Level boundary between the levels and all entries with Skill Level filters,
+		/// since skills of NPCs that level with the player can't be told from their level.
+		/// Entries are copied once for each range of crossed boundaries and reused afterwards. Must be called on the main thread.
+		/// </summary>
+		DataVec<Form>& GetForms(std::uint16_t a_oldLevel, std::uint16_t a_newLevel);
+
 		void LookupForms(RE::TESDataHandler*, std::string_view a_type, Distribution::INI::DataVec&);
 		void EmplaceForm(bool isValid, Form*, const bool& isFinal, const IndexOrCount&, const FilterData&, const Path&);
 
 		// Init formsWithLevels and formsNoLevels
 		void FinishLookupForms();
 
+#ifdef SPID_FILTER_JIT
+		/// Compiles filters of all entries into native code. Must be called after FinishLookupForms.
+		void CompileFilters(Filter::JIT::Compiler& a_compiler);
+#endif
+
 	private:
 		RECORD::TYPE  type;
 		DataVec<Form> forms{};
 		DataVec<Form> formsWithLevels{};
 
+		/// Sorted levels at which Actor Level filter of an entry in formsWithLevels starts or stops passing, along with the entry's position.
+		std::vector<std::pair<std::uint16_t, std::uint32_t>> levelBoundaries{};
+		/// Positions of entries in formsWithLevels that have Skill Level filters.
+		std::vector<std::uint32_t> skillLevelEntries{};
+		/// Entries affected by a level change, keyed by the range of levelBoundaries that the change crosses.
+		Map<std::uint64_t, DataVec<Form>> levelChanges{};
+
 		/// Total number of entries that were matched to this Distributable, including invalid.
 		/// This counter is used for logging purposes.
 		std::size_t lookupCount{ 0 };
@@ -580,7 +657,9 @@ template <class Form>
 void Forms::Distributables<Form>::EmplaceForm(bool isValid, Form* form, const bool& isFinal, const IndexOrCount& idxOrCount, const FilterData& filters, const Path& path)
 {
 	if (isValid) {
-		forms.emplace_back(forms.size(), isFinal, form, idxOrCount, filters, path);
+		forms.emplace_back(forms.size(), isFinal, form, idxOrCount, filters, Paths::Intern(path));
+		// Entries added after lookup (e.g. by tests) are not known to the index, so it can't be used anymore.
+		forms.candidates.Clear();
 	}
 	lookupCount++;
 }
@@ -588,6 +667,13 @@ void Forms::Distributables<Form>::EmplaceForm(bool isValid, Form* form, const bo
 template <class Form>
 void Forms::Distributables<Form>::FinishLookupForms()
 {
+	// Lookup can be finished again after entries were replaced, e.g. by tests.
+	formsWithLevels.clear();
+	formsWithLevels.candidates.Clear();
+	levelBoundaries.clear();
+	skillLevelEntries.clear();
+	levelChanges.clear();
+
 	if (forms.empty()) {
 		return;
 	}
@@ -597,7 +683,79 @@ void Forms::Distributables<Form>::FinishLookupForms()
 	std::copy_if(forms.begin(), forms.end(),
 		std::back_inserter(formsWithLevels),
 		[](const auto& formData) { return formData.filters.HasLevelFilters(); });
+
+	forms.candidates.Build(forms);
+	formsWithLevels.candidates.Build(formsWithLevels);
+
+	for (std::uint32_t i = 0; i < formsWithLevels.size(); ++i) {
+		const auto& [actorLevel, skillLevels, _] = formsWithLevels[i].filters.levels;
+		if (actorLevel.IsValid()) {
+			levelBoundaries.emplace_back(actorLevel.min, i);
+			if (actorLevel.max < std::numeric_limits<std::uint16_t>::max()) {
+				levelBoundaries.emplace_back(static_cast<std::uint16_t>(actorLevel.max + 1), i);
+			}
+		}
+		if (std::ranges::any_of(skillLevels, [](const auto& skillLevel) { return skillLevel.range.IsValid(); })) {
+			skillLevelEntries.push_back(i);
+		}
+	}
+
+	std::ranges::sort(levelBoundaries);
+}
+
+template <class Form>
+Forms::DataVec<Form>& Forms::Distributables<Form>::GetForms(std::uint16_t a_oldLevel, std::uint16_t a_newLevel)
+{
+	const auto [low, high] = std::minmax(a_oldLevel, a_newLevel);
+
+	// Verdict of an Actor Level filter changes only at levels in (low, high], and every level in the same interval between boundaries gives the same key.
+	const auto boundary = [&](std::uint16_t a_level) {
+		return static_cast<std::uint32_t>(std::ranges::upper_bound(levelBoundaries, a_level, {}, &std::pair<std::uint16_t, std::uint32_t>::first) - levelBoundaries.begin());
+	};
+	const auto first = boundary(low);
+	const auto last = boundary(high);
+
+	if (first == last && skillLevelEntries.empty()) {
+		return DistributionSet::empty<Form>();
+	}
+
+	const auto key = static_cast<std::uint64_t>(first) << 32 | last;
+	if (const auto it = levelChanges.find(key); it != levelChanges.end()) {
+		return it->second;
+	}
+
+	std::vector<std::uint32_t> positions{ skillLevelEntries };
+	for (auto i = first; i < last; ++i) {
+		positions.push_back(levelBoundaries[i].second);
+	}
+
+	// Entries keep the order of formsWithLevels, so that they are distributed the same way as they would be during full distribution.
+	std::ranges::sort(positions);
+	const auto [duplicates, end] = std::ranges::unique(positions);
+	positions.erase(duplicates, end);
+
+	auto& changed = levelChanges[key];
+	changed.reserve(positions.size());
+	for (const auto position : positions) {
+		changed.push_back(formsWithLevels[position]);
+	}
+	changed.candidates.Build(changed);
+
+	return changed;
+}
+
+#ifdef SPID_FILTER_JIT
+template <class Form>
+void Forms::Distributables<Form>::CompileFilters(Filter::JIT::Compiler& a_compiler)
+{
+	for (auto& formData : forms) {
+		formData.filters.program.Compile(a_compiler);
+	}
+	for (auto& formData : formsWithLevels) {
+		formData.filters.program.Compile(a_compiler);
+	}
 }
+#endif
 
 template <class Form>
 void Forms::LookupGenericForm(RE::TESDataHandler* const dataHandler, Distribution::INI::Data& rawForm, std::function<void(bool isValid, Form*, const bool& isFinal, const IndexOrCount&, const FilterData&, const Path& path)> callback)
@@ -652,10 +810,10 @@ void Forms::LookupGenericForm(RE::TESDataHandler* const dataHandler, Distributio
 
 inline std::ostream& operator<<(std::ostream& os, Forms::DistributedForm form)
 {
-	os << form.first;
+	os << form.form;
 
-	if (!form.second.empty()) {
-		os << " @" << form.second;
+	if (const auto& path = Paths::Get(form.path); !path.empty()) {
+		os << " @" << path;
 	}
 
 	return os;
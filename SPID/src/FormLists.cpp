@@ -0,0 +1,102 @@
+#include "FormLists.h"
+
+namespace FormLists
+{
+	namespace detail
+	{
+		/// Types of forms that can be matched by NPC::Data when they are used in Form Filters.
+		bool is_filterable(RE::FormType a_type)
+		{
+			switch (a_type) {
+			case RE::FormType::CombatStyle:
+			case RE::FormType::Class:
+			case RE::FormType::Faction:
+			case RE::FormType::Race:
+			case RE::FormType::Outfit:
+			case RE::FormType::NPC:
+			case RE::FormType::VoiceType:
+			case RE::FormType::Spell:
+			case RE::FormType::Armor:
+			case RE::FormType::Location:
+			case RE::FormType::Perk:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		/// A signature of list's content that changes whenever its forms change, even if their count stays the same (e.g. after Revert and AddForm).
+		std::uint64_t version(const RE::BGSListForm* a_list)
+		{
+			using namespace ankerl::unordered_dense::detail;
+
+			auto result = wyhash::hash(a_list->forms.data(), a_list->forms.size() * sizeof(RE::TESForm*));
+			if (const auto tempForms = a_list->scriptAddedTempForms; tempForms && !tempForms->empty()) {
+				result = wyhash::mix(result, wyhash::hash(tempForms->data(), tempForms->size() * sizeof(RE::FormID)));
+			}
+			return result;
+		}
+	}
+
+	bool Flattened::Contains(const Group& a_group, const RE::TESForm* a_form)
+	{
+		return a_form && std::ranges::binary_search(a_group.second, a_form->GetFormID(), {}, &RE::TESForm::GetFormID);
+	}
+
+	bool Flattened::IsUpToDate() const
+	{
+		return std::ranges::all_of(versions, [](const auto& a_version) { return detail::version(a_version.first) == a_version.second; });
+	}
+
+	std::shared_ptr<const Flattened> Manager::Get(RE::BGSListForm* a_list)
+	{
+		{
+			ReadLocker locker(lock);
+			if (const auto it = lists.find(a_list); it != lists.end() && it->second->IsUpToDate()) {
+				return it->second;
+			}
+		}
+
+		auto flattened = std::make_shared<Flattened>();
+
+		Map<RE::FormType, std::vector<RE::TESForm*>> groups{};
+		Set<const RE::BGSListForm*>                  visited{};
+
+		// Nested lists are expanded iteratively, and each list is visited once, even if lists reference each other.
+		std::vector<RE::BGSListForm*> pending{ a_list };
+		while (!pending.empty()) {
+			const auto list = pending.back();
+			pending.pop_back();
+
+			if (!visited.insert(list).second) {
+				continue;
+			}
+
+			flattened->versions.emplace_back(list, detail::version(list));
+
+			list->ForEachForm([&](RE::TESForm* a_form) {
+				if (!a_form) {
+					return RE::BSContainer::ForEachResult::kContinue;
+				}
+				if (const auto nested = a_form->As<RE::BGSListForm>()) {
+					pending.push_back(nested);
+				} else if (detail::is_filterable(a_form->GetFormType())) {
+					groups[a_form->GetFormType()].push_back(a_form);
+				}
+				return RE::BSContainer::ForEachResult::kContinue;
+			});
+		}
+
+		flattened->groups.reserve(groups.size());
+		for (auto& [type, forms] : groups) {
+			std::ranges::sort(forms, {}, &RE::TESForm::GetFormID);
+			const auto [first, last] = std::ranges::unique(forms);
+			forms.erase(first, last);
+			flattened->groups.emplace_back(type, std::move(forms));
+		}
+
+		WriteLocker locker(lock);
+		lists[a_list] = flattened;
+		return flattened;
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+/// FormLists that are used as Form Filters are flattened once instead of being walked recursively for every NPC.
+namespace FormLists
+{
+	/// <summary>
+	/// Forms of a FormList and all of its nested FormLists, grouped by form type and sorted by FormID.
+	///
+	/// Only forms of types that can be matched by Form Filters are kept.
+	/// </summary>
+	struct Flattened
+	{
+		using Group = std::pair<RE::FormType, std::vector<RE::TESForm*>>;
+
+		std::vector<Group> groups{};
+
+		/// Checks whether the group of forms with given type contains the form.
+		[[nodiscard]] static bool Contains(const Group& a_group, const RE::TESForm* a_form);
+
+		/// Whether none of the flattened lists changed since they were flattened.
+		[[nodiscard]] bool IsUpToDate() const;
+
+	private:
+		friend class Manager;
+
+		/// Each flattened list along with its version at the time of flattening.
+		std::vector<std::pair<const RE::BGSListForm*, std::uint64_t>> versions{};
+	};
+
+	/// <summary>
+	/// Keeps flattened FormLists.
+	///
+	/// Lists can be modified at runtime (e.g. with Papyrus AddForm/RemoveAddedForm),
+	/// so each flattened list is validated against versions of all lists it was built from and rebuilt when any of them changes.
+	/// </summary>
+	class Manager : public ISingleton<Manager>
+	{
+	public:
+		/// Returns flattened forms of the list, flattening it if it wasn't flattened yet or has changed since then.
+		std::shared_ptr<const Flattened> Get(RE::BGSListForm* a_list);
+
+	private:
+		mutable Lock                                                    lock;
+		Map<const RE::BGSListForm*, std::shared_ptr<const Flattened>> lists{};
+	};
+}
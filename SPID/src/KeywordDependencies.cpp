@@ -1,6 +1,7 @@
 #include "KeywordDependencies.h"
 #include "DependencyResolver.h"
 #include "FormData.h"
+#include "Patterns.h"
 
 using Keyword = RE::BGSKeyword*;
 
@@ -97,6 +98,18 @@ void Dependencies::ResolveKeywords()
 		}
 	}
 
+	// Find the first keyword that contains each partial string filter.
+	Patterns::matcher.Build(dataHandler);
+
+	std::vector<RE::BGSKeyword*> partialMatches(Patterns::matcher.GetSize(), nullptr);
+	for (const auto& [keywordName, keyword] : allKeywords) {
+		Patterns::matcher.ForEachMatch(keyword, [&](const Pattern pattern) {
+			if (!partialMatches[pattern]) {
+				partialMatches[pattern] = keyword;
+			}
+		});
+	}
+
 	keyword_less::RelativeOrderMap orderMap;
 
 	for (std::int32_t index = 0; index < keywordForms.size(); ++index) {
@@ -130,14 +143,11 @@ void Dependencies::ResolveKeywords()
 		addDependencies(stringFilters.ALL, findKeyword);
 		addDependencies(stringFilters.NOT, findKeyword);
 		addDependencies(stringFilters.MATCH, findKeyword);
-		addDependencies(stringFilters.ANY, [&](const std::string& name) -> RE::BGSKeyword* {
-			for (const auto& [keywordName, keyword] : allKeywords) {
-				if (string::icontains(keywordName, name)) {
-					return keyword;
-				}
+		for (const auto& pattern : formData.filters.stringPatterns) {
+			if (const auto& kwd = partialMatches[pattern]; kwd) {
+				AddDependency(resolver, formData.form, kwd);
 			}
-			return nullptr;
-		});
+		}
 	}
 
 	const auto result = resolver.resolve();
@@ -187,12 +187,6 @@ namespace LinkedDistribution
 			}
 		}
 
-		// Remove empty linked forms
-		ForEachLinkedForms([&]<typename Form>(LinkedForms<Form>& forms) {
-			std::erase_if(forms.forms[kRegular], [](const auto& pair) { return pair.second.empty(); });
-			std::erase_if(forms.forms[kDeath], [](const auto& pair) { return pair.second.empty(); });
-		});
-
 		// Clear INI once lookup is done
 		INI::linkedConfigs.clear();
 
@@ -202,22 +196,24 @@ namespace LinkedDistribution
 
 	void Manager::LogLinkedFormsLookup(DistributionType type)
 	{
-		ForEachLinkedForms([&]<typename Form>(LinkedForms<Form>& linkedConfigs) {
-			if (linkedConfigs.forms[type].empty()) {
-				return;
-			}
+		ForEachLinkedForms([&]<typename Form>(LinkedForms<Form>& linkedForms) {
 			std::unordered_map<RE::TESForm*, std::vector<DistributedForm>> map{};
 
-			// Iterate through the original map
-			for (const auto& [path, formsMap] : linkedConfigs.forms[type]) {
-				for (const auto& [key, values] : formsMap) {
-					for (const auto& value : values) {
-						map[value.form].emplace_back(key, path);
-					}
+			// Group parents by linked forms.
+			for (const auto& [key, set] : linkedSets) {
+				if (detail::get_distribution_type(key) != type) {
+					continue;
+				}
+				for (const auto& value : linkedForms.GetForms(set)) {
+					map[value.form].push_back(set.parent);
 				}
 			}
 
-			const auto& recordName = RECORD::GetTypeName(linkedConfigs.GetType());
+			if (map.empty()) {
+				return;
+			}
+
+			const auto& recordName = RECORD::GetTypeName(linkedForms.GetType());
 			logger::info("Linked {}s: ", recordName);
 
 			for (const auto& [form, linkedConfigs] : map) {
@@ -234,67 +230,121 @@ namespace LinkedDistribution
 		});
 	}
 
+	void Manager::LogLinkedCycles(DistributionType type)
+	{
+		enum class State : std::uint8_t
+		{
+			kVisiting,
+			kVisited
+		};
+
+		Map<const LinkedSet*, State>  states{};
+		std::vector<const LinkedSet*> chain{};
+
+		std::function<void(const LinkedSet&)> visit = [&](const LinkedSet& set) {
+			states.emplace(&set, State::kVisiting);
+			chain.push_back(&set);
+
+			ForEachLinkedForms([&]<typename Form>(LinkedForms<Form>& linkedForms) {
+				for (const auto& entry : linkedForms.GetForms(set)) {
+					ForEachLinkedSet(type, { entry.form, entry.path }, [&](const LinkedSet& next) {
+						const auto it = states.find(&next);
+						if (it == states.end()) {
+							visit(next);
+						} else if (it->second == State::kVisiting) {
+							std::string cycle{};
+							for (auto linked = std::ranges::find(chain, &next); linked != chain.end(); ++linked) {
+								cycle += describe((*linked)->parent.form) + " -> ";
+							}
+							cycle += describe(next.parent.form);
+
+							logger::warn("\tLinked forms make a cycle: {}. Each of them will be distributed at most once per NPC.", cycle);
+						}
+					});
+				}
+			});
+
+			chain.pop_back();
+			states[&set] = State::kVisited;
+		};
+
+		for (const auto& [key, set] : linkedSets) {
+			if (detail::get_distribution_type(key) == type && !states.contains(&set)) {
+				visit(set);
+			}
+		}
+	}
+
 	void Manager::LogLinkedFormsLookup()
 	{
 		if (!IsEmpty(kRegular)) {
 			LOG_HEADER("LINKED FORMS");
 
 			LogLinkedFormsLookup(kRegular);
+			LogLinkedCycles(kRegular);
 		}
 
 		if (!IsEmpty(kDeath)) {
 			LOG_HEADER("LINKED ON DEATH FORMS");
 
 			LogLinkedFormsLookup(kDeath);
+			LogLinkedCycles(kDeath);
 		}
 	}
 #pragma endregion
 
 #pragma region Distribution
-	void Manager::ForEachLinkedDistributionSet(DistributionType type, const DistributedForms& targetForms, Scope scope, std::function<void(DistributionSet&)> performDistribution)
+	DistributionSet Manager::GetEntries(const LinkedSet& set)
 	{
-		for (const auto& form : targetForms) {
-			DistributionSet linkedEntries{
-				LinkedFormsForForm(type, form, scope, spells),
-				LinkedFormsForForm(type, form, scope, perks),
-				LinkedFormsForForm(type, form, scope, items),
-				LinkedFormsForForm(type, form, scope, shouts),
-				LinkedFormsForForm(type, form, scope, levSpells),
-				LinkedFormsForForm(type, form, scope, packages),
-				LinkedFormsForForm(type, form, scope, outfits),
-				LinkedFormsForForm(type, form, scope, keywords),
-				LinkedFormsForForm(type, form, scope, factions),
-				LinkedFormsForForm(type, form, scope, sleepOutfits),
-				LinkedFormsForForm(type, form, scope, skins)
-			};
-
-			if (linkedEntries.IsEmpty()) {
-				continue;
-			}
-
-			performDistribution(linkedEntries);
-		}
+		return {
+			spells.GetForms(set),
+			perks.GetForms(set),
+			items.GetForms(set),
+			shouts.GetForms(set),
+			levSpells.GetForms(set),
+			packages.GetForms(set),
+			outfits.GetForms(set),
+			keywords.GetForms(set),
+			factions.GetForms(set),
+			sleepOutfits.GetForms(set),
+			skins.GetForms(set)
+		};
 	}
 
 	void Manager::ForEachLinkedDistributionSet(DistributionType type, const DistributedForms& targetForms, std::function<void(DistributionSet&)> performDistribution)
 	{
-		ForEachLinkedDistributionSet(type, targetForms, Scope::kLocal, performDistribution);
-		ForEachLinkedDistributionSet(type, targetForms, Scope::kGlobal, performDistribution);
+		if (linkedSets.empty()) {
+			return;
+		}
+
+		// Forms whose linked forms were already distributed. Each form is expanded once, which also stops cycles of links.
+		DistributedForms expanded{};
+
+		bool distributed = true;
+		while (distributed) {
+			distributed = false;
+
+			// Distribution of linked forms adds them to targetForms, which would invalidate iterators of the flat set.
+			// So each pass goes over a copy, and forms that it adds are expanded by the next pass.
+			const auto forms = targetForms;
+
+			for (const auto& form : forms) {
+				if (!expanded.insert(form)) {
+					continue;
+				}
+
+				ForEachLinkedSet(type, form, [&](const LinkedSet& set) {
+					auto linkedEntries = GetEntries(set);
+					performDistribution(linkedEntries);
+					distributed = true;
+				});
+			}
+		}
 	}
 
 	bool Manager::IsEmpty(DistributionType type) const
 	{
-		return spells.IsEmpty(type) &&
-		       perks.IsEmpty(type) &&
-		       items.IsEmpty(type) &&
-		       shouts.IsEmpty(type) &&
-		       levSpells.IsEmpty(type) &&
-		       packages.IsEmpty(type) &&
-		       outfits.IsEmpty(type) &&
-		       keywords.IsEmpty(type) &&
-		       factions.IsEmpty(type) &&
-		       sleepOutfits.IsEmpty(type) &&
-		       skins.IsEmpty(type);
+		return std::ranges::none_of(linkedSets, [&](const auto& pair) { return detail::get_distribution_type(pair.first) == type; });
 	}
 #pragma endregion
 }
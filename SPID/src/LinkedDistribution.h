@@ -73,10 +73,39 @@ namespace LinkedDistribution
 
 	class Manager;
 
+	/// <summary>
+	/// Forms of all types that are linked to a single parent form within a config, or globally.
+	///
+	/// Linked entries themselves are stored in LinkedForms of each type, grouped by sets that they belong to.
+	/// The set only refers to its groups, so that parents with links of just one or two types stay small.
+	/// </summary>
+	struct LinkedSet
+	{
+		static constexpr std::size_t typeCount = 11;
+
+		DistributedForm                      parent{};  // Parent form and the config that links to it. Global links have no config.
+		std::array<std::uint32_t, typeCount> groups{};  // 1-based indices of groups in LinkedForms of each type, 0 when there are no linked forms of that type.
+	};
+
+	/// Packed key of a LinkedSet: distribution type in the highest bit, config path ID in the rest of the high half and FormID of the parent form in the low half.
+	using LinkKey = std::uint64_t;
+
+	using LinkedSets = Map<LinkKey, LinkedSet>;
+
 	namespace detail
 	{
 		template <class Form = RE::TESForm>
 		Form* LookupLinkedForm(RE::TESDataHandler* const dataHandler, INI::RawLinkedForm& rawForm);
+
+		inline LinkKey make_link_key(DistributionType a_type, Paths::ID a_path, RE::FormID a_parent)
+		{
+			return static_cast<LinkKey>(a_type) << 63 | static_cast<LinkKey>(a_path) << 32 | a_parent;
+		}
+
+		inline DistributionType get_distribution_type(LinkKey a_key)
+		{
+			return static_cast<DistributionType>(a_key >> 63);
+		}
 	}
 
 	template <class Form>
@@ -85,28 +114,28 @@ namespace LinkedDistribution
 		friend Manager;  // allow Manager to later modify forms directly.
 		friend Form* detail::LookupLinkedForm(RE::TESDataHandler* const, INI::RawLinkedForm&);
 
-		using FormsMap = std::unordered_map<DistributionType, std::unordered_map<Path, std::unordered_map<RE::TESForm*, DataVec<Form>>>>;
-
-		LinkedForms(RECORD::TYPE type) :
-			type(type)
+		LinkedForms(RECORD::TYPE type, std::size_t slot, LinkedSets& sets) :
+			type(type),
+			slot(slot),
+			sets(sets)
 		{}
 
-		bool IsEmpty(DistributionType distributionType) const
+		RECORD::TYPE GetType() const { return type; }
+
+		/// Entries of this type that are linked by the set.
+		DataVec<Form>& GetForms(const LinkedSet& set)
 		{
-			if (const auto it = forms.find(distributionType); it != forms.end()) {
-				return it->second.empty();
-			}
-			return true;
+			const auto group = set.groups[slot];
+			return group ? groups[group - 1] : DistributionSet::empty<Form>();
 		}
 
-		RECORD::TYPE    GetType() const { return type; }
-		const FormsMap& GetForms() const { return forms; }
-
 		void LookupForms(RE::TESDataHandler* const, INI::LinkedFormsVec& rawLinkedForms);
 
 	private:
-		RECORD::TYPE type;
-		FormsMap     forms{};
+		RECORD::TYPE               type;
+		std::size_t                slot;  // Index of this type in LinkedSet::groups.
+		LinkedSets&                sets;
+		std::vector<DataVec<Form>> groups{};
 
 		void Link(Form*, Scope, DistributionType, bool isFinal, const FormVec& linkedConfigs, const IndexOrCount&, const PercentChance&, const Path&);
 	};
@@ -126,7 +155,11 @@ namespace LinkedDistribution
 		bool IsEmpty(DistributionType) const;
 
 		/// <summary>
-		/// Calculates DistributionSet for each linked form and calls a callback for each of them.
+		/// Calls a callback with DistributionSet of each form that has linked forms.
+		///
+		/// Linking is transitive: forms that the callback distributes are added to linkedConfigs,
+		/// and their own linked forms are distributed in turn, until no new forms are distributed.
+		/// Forms linked within the config of a distributed form are distributed before forms linked to it globally.
 		/// </summary>
 		/// <param name="distributionType">Type of the distribution for which linked sets should be returned.</param>
 		/// <param name="linkedForms">A set of forms for which distribution sets should be calculated.
@@ -135,24 +168,30 @@ namespace LinkedDistribution
 		void ForEachLinkedDistributionSet(DistributionType, const DistributedForms& linkedConfigs, std::function<void(DistributionSet&)> distribute);
 
 	private:
-		template <class Form>
-		DataVec<Form>& LinkedFormsForForm(DistributionType, const DistributedForm&, Scope, LinkedForms<Form>&) const;
+		/// Calls a callback with the set of forms that are linked to the form within its config, and then with the set of forms that are linked to it globally.
+		template <typename Func>
+		void ForEachLinkedSet(DistributionType, const DistributedForm&, Func&& func);
+
+		[[nodiscard]] DistributionSet GetEntries(const LinkedSet&);
 
 		void LogLinkedFormsLookup(DistributionType);
 
-		void ForEachLinkedDistributionSet(DistributionType, const DistributedForms& linkedConfigs, Scope, std::function<void(DistributionSet&)> distribute);
+		/// Warns about cycles of linked forms. Cycles are safe, since each form is expanded once per NPC, but they are likely unintended.
+		void LogLinkedCycles(DistributionType);
+
+		LinkedSets linkedSets{};  // Sets of both distribution types, so that each distributed form is looked up in a single flat table.
 
-		LinkedForms<RE::SpellItem>      spells{ RECORD::kSpell };
-		LinkedForms<RE::BGSPerk>        perks{ RECORD::kPerk };
-		LinkedForms<RE::TESBoundObject> items{ RECORD::kItem };
-		LinkedForms<RE::TESShout>       shouts{ RECORD::kShout };
-		LinkedForms<RE::TESLevSpell>    levSpells{ RECORD::kLevSpell };
-		LinkedForms<RE::TESForm>        packages{ RECORD::kPackage };
-		LinkedForms<RE::BGSOutfit>      outfits{ RECORD::kOutfit };
-		LinkedForms<RE::BGSOutfit>      sleepOutfits{ RECORD::kSleepOutfit };
-		LinkedForms<RE::BGSKeyword>     keywords{ RECORD::kKeyword };
-		LinkedForms<RE::TESFaction>     factions{ RECORD::kFaction };
-		LinkedForms<RE::TESObjectARMO>  skins{ RECORD::kSkin };
+		LinkedForms<RE::SpellItem>      spells{ RECORD::kSpell, 0, linkedSets };
+		LinkedForms<RE::BGSPerk>        perks{ RECORD::kPerk, 1, linkedSets };
+		LinkedForms<RE::TESBoundObject> items{ RECORD::kItem, 2, linkedSets };
+		LinkedForms<RE::TESShout>       shouts{ RECORD::kShout, 3, linkedSets };
+		LinkedForms<RE::TESLevSpell>    levSpells{ RECORD::kLevSpell, 4, linkedSets };
+		LinkedForms<RE::TESForm>        packages{ RECORD::kPackage, 5, linkedSets };
+		LinkedForms<RE::BGSOutfit>      outfits{ RECORD::kOutfit, 6, linkedSets };
+		LinkedForms<RE::BGSOutfit>      sleepOutfits{ RECORD::kSleepOutfit, 7, linkedSets };
+		LinkedForms<RE::BGSKeyword>     keywords{ RECORD::kKeyword, 8, linkedSets };
+		LinkedForms<RE::TESFaction>     factions{ RECORD::kFaction, 9, linkedSets };
+		LinkedForms<RE::TESObjectARMO>  skins{ RECORD::kSkin, 10, linkedSets };
 
 		/// <summary>
 		/// Iterates over each type of LinkedForms and calls a callback with each of them.
@@ -210,18 +249,20 @@ namespace LinkedDistribution
 		return nullptr;
 	}
 
-	template <class Form>
-	DataVec<Form>& Manager::LinkedFormsForForm(DistributionType type, const DistributedForm& form, Scope scope, LinkedForms<Form>& linkedConfigs) const
+	template <typename Func>
+	void Manager::ForEachLinkedSet(DistributionType type, const DistributedForm& form, Func&& func)
 	{
-		auto& forms = linkedConfigs.forms[type];
-		if (const auto formsIt = forms.find(scope == kLocal ? form.second : ""); formsIt != forms.end()) {
-			if (const auto linkedFormsIt = formsIt->second.find(form.first); linkedFormsIt != formsIt->second.end()) {
-				return linkedFormsIt->second;
+		const auto formID = form.form->GetFormID();
+
+		if (form.path != Paths::none) {
+			if (const auto it = linkedSets.find(detail::make_link_key(type, form.path, formID)); it != linkedSets.end()) {
+				func(it->second);
 			}
 		}
 
-		static DataVec<Form> empty{};
-		return empty;
+		if (const auto it = linkedSets.find(detail::make_link_key(type, Paths::none, formID)); it != linkedSets.end()) {
+			func(it->second);
+		}
 	}
 
 	template <typename Func, typename... Args>
@@ -257,13 +298,23 @@ namespace LinkedDistribution
 	template <class Form>
 	void LinkedForms<Form>::Link(Form* form, Scope scope, DistributionType distributionType, bool isFinal, const FormVec& linkedConfigs, const IndexOrCount& idxOrCount, const PercentChance& chance, const Path& path)
 	{
+		const auto pathID = Paths::Intern(path);
+		const auto setPathID = scope == kLocal ? pathID : Paths::none;  // If item is global, we put it in a common set with no information about the path.
 		for (const auto& linkedForm : linkedConfigs) {
 			if (std::holds_alternative<RE::TESForm*>(linkedForm)) {
-				auto& distributableFormsAtPath = forms[distributionType][scope == kLocal ? path : ""];  // If item is global, we put it in a common map with no information about the path.
-				auto& distributableForms = distributableFormsAtPath[std::get<RE::TESForm*>(linkedForm)];
+				const auto parent = std::get<RE::TESForm*>(linkedForm);
+
+				auto& set = sets[detail::make_link_key(distributionType, setPathID, parent->GetFormID())];
+				set.parent = { parent, setPathID };
+
+				auto& group = set.groups[slot];
+				if (!group) {
+					groups.emplace_back();
+					group = static_cast<std::uint32_t>(groups.size());
+				}
 				// Note that we don't use Data.index here, as these linked forms don't have any leveled filters
 				// and as such do not to track their index.
-				distributableForms.emplace_back(0, isFinal, form, idxOrCount, FilterData({}, {}, {}, {}, chance), path);
+				groups[group - 1].emplace_back(0, isFinal, form, idxOrCount, FilterData({}, {}, {}, {}, chance), pathID);
 			}
 		}
 	}
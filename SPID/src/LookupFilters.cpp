@@ -1,33 +1,48 @@
 #include "LookupFilters.h"
+#include "FormLists.h"
 #include "LookupNPC.h"
 
 namespace Filter
 {
 	Data::Data(StringFilters a_strings, FormFilters a_formFilters, LevelFilters a_level, Traits a_traits, PercentChance a_chance) :
 		strings(std::move(a_strings)),
+		stringAtoms{ Atoms::Intern(strings.ALL), Atoms::Intern(strings.NOT), Atoms::Intern(strings.MATCH) },
+		stringPatterns(Patterns::matcher.Register(strings.ANY)),
 		forms(std::move(a_formFilters)),
 		levels(std::move(a_level)),
 		traits(a_traits),
-		chance(a_chance / 100)
+		traitMask(traits),
+		chance(a_chance / 100),
+		program(stringAtoms, stringPatterns, forms, levels, traitMask),
+		programID(programs.Intern(program))
 	{
 		hasLeveledFilters = HasLevelFiltersImpl();
+
+		// FormLists are flattened during lookup, so that distribution only needs to validate them.
+		for (const auto* formVec : { &forms.ALL, &forms.NOT, &forms.MATCH }) {
+			for (const auto& formOrMod : *formVec) {
+				if (const auto form = std::get_if<RE::TESForm*>(&formOrMod); form && (*form)->Is(RE::FormType::FormList)) {
+					FormLists::Manager::GetSingleton()->Get((*form)->As<RE::BGSListForm>());
+				}
+			}
+		}
 	}
 
 	Result Data::passed_string_filters(const NPCData& a_npcData) const
 	{
-		if (!strings.ALL.empty() && !a_npcData.HasStringFilter(strings.ALL, true)) {
+		if (!stringAtoms.ALL.empty() && !a_npcData.HasStringFilter(stringAtoms.ALL, true)) {
 			return Result::kFail;
 		}
 
-		if (!strings.NOT.empty() && a_npcData.HasStringFilter(strings.NOT)) {
+		if (!stringAtoms.NOT.empty() && a_npcData.HasStringFilter(stringAtoms.NOT)) {
 			return Result::kFail;
 		}
 
-		if (!strings.MATCH.empty() && !a_npcData.HasStringFilter(strings.MATCH)) {
+		if (!stringAtoms.MATCH.empty() && !a_npcData.HasStringFilter(stringAtoms.MATCH)) {
 			return Result::kFail;
 		}
 
-		if (!strings.ANY.empty() && !a_npcData.ContainsStringFilter(strings.ANY)) {
+		if (!stringPatterns.empty() && !a_npcData.ContainsStringFilter(stringPatterns)) {
 			return Result::kFail;
 		}
 
@@ -192,16 +207,39 @@ namespace Filter
 		});
 	}
 
-	Result Data::PassedFilters(const NPCData& a_npcData) const
+	Result Data::PassedFilters(const NPCData& a_npcData, const Random::Stream& a_stream) const
 	{
 		// Fail chance first to avoid running unnecessary checks
 		if (chance < 1) {
-			const auto randNum = RNG().generate();
+			const auto randNum = a_stream.Chance();
+			if (randNum > chance) {
+				return Result::kFailRNG;
+			}
+		}
+
+		return program.Evaluate(a_npcData) ? Result::kPass : Result::kFail;
+	}
+
+	Result Data::PassedFiltersMemoized(const NPCData& a_npcData, const Random::Stream& a_stream) const
+	{
+		if (chance < 1) {
+			const auto randNum = a_stream.Chance();
 			if (randNum > chance) {
 				return Result::kFailRNG;
 			}
 		}
 
+		auto verdict = a_npcData.GetVerdict(programID);
+		if (!verdict) {
+			verdict = program.Evaluate(a_npcData);
+			a_npcData.SetVerdict(programID, *verdict);
+		}
+
+		return *verdict ? Result::kPass : Result::kFail;
+	}
+
+	Result Data::PassedFiltersReference(const NPCData& a_npcData) const
+	{
 		if (passed_string_filters(a_npcData) == Result::kFail) {
 			return Result::kFail;
 		}
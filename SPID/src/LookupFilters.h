@@ -1,9 +1,9 @@
 #pragma once
 
-namespace NPC
-{
-	struct Data;
-}
+#include "Atoms.h"
+#include "FilterProgram.h"
+#include "Patterns.h"
+#include "Random.h"
 
 namespace Filter
 {
@@ -19,16 +19,36 @@ namespace Filter
 		// Note that chance passed to this constructor is expected to be in percent. It will be converted to a decimal chance by the constructor.
 		Data(StringFilters a_strings, FormFilters a_formFilters, LevelFilters a_level, Traits a_traits, PercentChance a_chance);
 
-		StringFilters strings{};
-		FormFilters   forms{};
-		LevelFilters  levels{};
-		Traits        traits{};
-		DecimalChance chance{ 1 };
+		StringFilters    strings{};
+		Filters<Atom>    stringAtoms{};     // ALL, NOT and MATCH strings interned as Atoms
+		PatternVec       stringPatterns{};  // ANY strings registered as Patterns
+		FormFilters      forms{};
+		LevelFilters     levels{};
+		Traits           traits{};
+		TraitMask        traitMask{};  // Traits converted into flags that are compared with NPC's traits.
+		DecimalChance    chance{ 1 };
+		Program          program{};       // All filters except chance compiled into a Program.
+		ProgramTable::ID programID{ 0 };  // ID that is shared by all entries with equal Programs.
 
 		bool hasLeveledFilters;
 
 		[[nodiscard]] bool   HasLevelFilters() const;
-		[[nodiscard]] Result PassedFilters(const NPC::Data& a_npcData) const;
+		/// Checks whether NPC passes the filters. Chance is rolled with a_stream.
+		[[nodiscard]] Result PassedFilters(const NPC::Data& a_npcData, const Random::Stream& a_stream) const;
+
+		/// <summary>
+		/// Same as PassedFilters, but reuses the verdict of an equal Program that was already evaluated for this NPC.
+		///
+		/// Chance is still rolled for each entry. Verdicts must be cleared whenever NPC changes in a way that affects filters.
+		/// </summary>
+		[[nodiscard]] Result PassedFiltersMemoized(const NPC::Data& a_npcData, const Random::Stream& a_stream) const;
+
+		/// <summary>
+		/// Evaluates all filters except chance directly, without the compiled Program.
+		///
+		/// This is the reference implementation that is used to verify Programs.
+		/// </summary>
+		[[nodiscard]] Result PassedFiltersReference(const NPC::Data& a_npcData) const;
 
 	private:
 		[[nodiscard]] bool HasLevelFiltersImpl() const;
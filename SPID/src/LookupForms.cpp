@@ -1,9 +1,12 @@
 #include "LookupForms.h"
+#include "Atoms.h"
+#include "Patterns.h"
 #include "DeathDistribution.h"
 #include "ExclusiveGroups.h"
 #include "FormData.h"
 #include "KeywordDependencies.h"
 #include "LinkedDistribution.h"
+#include "PlanCache.h"
 
 bool LookupDistributables(RE::TESDataHandler* const dataHandler)
 {
@@ -85,6 +88,15 @@ bool LookupDistributables(RE::TESDataHandler* const dataHandler)
 		}
 	});
 
+#ifdef SPID_FILTER_JIT
+	if (const auto totalEntries = GetTotalEntries(); totalEntries >= Filter::JIT::minEntries) {
+		ForEachDistributable([&]<typename Form>(Distributables<Form>& a_distributable) {
+			a_distributable.CompileFilters(Filter::JIT::compiler);
+		});
+		logger::info("Compiled filters of {} entries into {} bytes of native code", totalEntries, Filter::JIT::compiler.GetSize());
+	}
+#endif
+
 	return valid;
 }
 
@@ -171,6 +183,13 @@ bool Lookup::LookupForms()
 		LookupExclusiveGroups(dataHandler);
 		LogExclusiveGroupsLookup();
 
+		// All String Filters are interned by now, so keywords can be mapped to their Atoms and Patterns once, instead of scanning EditorIDs for every NPC.
+		Atoms::table.InternKeywords(dataHandler);
+		Patterns::matcher.Build(dataHandler);
+
+		// Traces and level buckets were built from the previous entries.
+		Distribute::PlanCache::Manager::GetSingleton()->Clear();
+
 		return success;
 	}
 
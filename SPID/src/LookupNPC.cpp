@@ -1,29 +1,20 @@
 #include "LookupNPC.h"
 #include "ExclusiveGroups.h"
+#include "FilterProgram.h"
 #include "Outfits/OutfitManager.h"
 
 namespace NPC
 {
 	Data::ID::ID(const RE::TESForm* a_base) :
-		formID(a_base->GetFormID()),
-		editorID(editorID::get_editorID(a_base))
+		form(a_base),
+		formID(a_base->GetFormID())
 	{}
 
-	bool Data::ID::contains(const std::string& a_str) const
-	{
-		return string::icontains(editorID, a_str);
-	}
-
 	bool Data::ID::operator==(const RE::TESFile* a_mod) const
 	{
 		return a_mod->IsFormInMod(formID);
 	}
 
-	bool Data::ID::operator==(const std::string& a_str) const
-	{
-		return string::iequals(editorID, a_str);
-	}
-
 	bool Data::ID::operator==(RE::FormID a_formID) const
 	{
 		return formID == a_formID;
@@ -36,41 +27,141 @@ namespace NPC
 		npc(a_npc),
 		actor(a_actor),
 		race(a_actor->GetRace()),
-		name(a_actor->GetName()),
 		level(a_npc->GetLevel()),
-		child(a_actor->IsChild() || race && race->formEditorID.contains("RaceChild")),
+		child(a_actor->IsChild() || race && Records::Cache::GetSingleton()->GetRace(race).child),
 		leveled(a_actor->IsLeveled()),
 		dying(isDying)
+	{}
+
+	const std::vector<Data::ID>& Data::get_IDs() const
 	{
-		npc->ForEachKeyword([&](const RE::BGSKeyword* a_keyword) {
-			keywords.emplace(a_keyword->GetFormEditorID());
-			return RE::BSContainer::ForEachResult::kContinue;
-		});
+		if (IDs) {
+			return *IDs;
+		}
+
+		auto& result = IDs.emplace();
 
 		if (npc->baseTemplateForm) {
-			IDs.emplace_back(npc->baseTemplateForm);
+			result.emplace_back(npc->baseTemplateForm);
 		}
 
-		if (const auto extraLvlCreature = a_actor->extraList.GetByType<RE::ExtraLeveledCreature>()) {
+		if (const auto extraLvlCreature = actor->extraList.GetByType<RE::ExtraLeveledCreature>()) {
 			if (const auto originalBase = extraLvlCreature->originalBase) {
-				IDs.emplace_back(originalBase);
+				result.emplace_back(originalBase);
 			}
 			if (const auto templateBase = extraLvlCreature->templateBase) {
-				IDs.emplace_back(templateBase);
+				result.emplace_back(templateBase);
 			}
 		} else {
-			IDs.emplace_back(npc);
+			result.emplace_back(npc);
 		}
 
+		return result;
+	}
+
+	const StringSet& Data::get_keywords() const
+	{
+		if (keywords) {
+			return *keywords;
+		}
+
+		auto& result = keywords.emplace();
+
+		// EditorIDs are folded once here, so that has_keyword_string can look them up directly.
+		npc->ForEachKeyword([&](const RE::BGSKeyword* a_keyword) {
+			result.emplace(CaseFold::folded(a_keyword->GetFormEditorID()));
+			return RE::BSContainer::ForEachResult::kContinue;
+		});
+
 		if (race) {
-			race->ForEachKeyword([&](const RE::BGSKeyword* a_keyword) {
-				keywords.emplace(a_keyword->GetFormEditorID());
-				return RE::BSContainer::ForEachResult::kContinue;
-			});
+			const auto& raceKeywords = Records::Cache::GetSingleton()->GetRace(race).keywords;
+			result.insert(raceKeywords.begin(), raceKeywords.end());
+		}
+
+		return result;
+	}
+
+	const Data::Strings& Data::get_strings() const
+	{
+		if (strings) {
+			return *strings;
+		}
+
+		auto& result = strings.emplace();
+
+		npc->ForEachKeyword([&](const RE::BGSKeyword* a_keyword) {
+			insert_atom(result, Atoms::Find(a_keyword));
+			Patterns::matcher.Match(a_keyword, result.patterns);
+			return RE::BSContainer::ForEachResult::kContinue;
+		});
+
+		const std::string name{ actor->GetName() };
+		insert_atom(result, Atoms::Find(name));
+		Patterns::matcher.Match(name, result.patterns);
+
+		// Strings of races and templates are shared by many actors, so they are collected once per record.
+		const auto merge = [&](const Records::Strings& a_strings) {
+			result.atoms.merge(a_strings.atoms);
+			result.patterns.merge(a_strings.patterns);
+		};
+
+		const auto cache = Records::Cache::GetSingleton();
+		if (race) {
+			merge(cache->GetRace(race).strings);
+		}
+		for (const auto& ID : get_IDs()) {
+			merge(cache->GetTemplate(ID.form));
 		}
 
-		std::call_once(init, [&] { potentialFollowerFaction = RE::TESForm::LookupByID<RE::TESFaction>(0x0005C84D); });
-		teammate = actor->IsPlayerTeammate() || potentialFollowerFaction && npc->IsInFaction(potentialFollowerFaction);
+		return result;
+	}
+
+	void Data::init_features() const
+	{
+		auto& result = features.emplace();
+
+		result.level = level;
+
+		std::ranges::copy(npc->playerSkills.values, result.skills.begin());
+
+		if (const auto npcClass = npc->npcClass) {
+			const auto& weights = npcClass->data.skillWeights;
+
+			using Skill = RE::TESNPC::Skills;
+			result.hasClass = true;
+			result.skillWeights[Skill::kOneHanded] = weights.oneHanded;
+			result.skillWeights[Skill::kTwoHanded] = weights.twoHanded;
+			result.skillWeights[Skill::kMarksman] = weights.archery;
+			result.skillWeights[Skill::kBlock] = weights.block;
+			result.skillWeights[Skill::kSmithing] = weights.smithing;
+			result.skillWeights[Skill::kHeavyArmor] = weights.heavyArmor;
+			result.skillWeights[Skill::kLightArmor] = weights.lightArmor;
+			result.skillWeights[Skill::kPickpocket] = weights.pickpocket;
+			result.skillWeights[Skill::kLockpicking] = weights.lockpicking;
+			result.skillWeights[Skill::kSneak] = weights.sneak;
+			result.skillWeights[Skill::kAlchemy] = weights.alchemy;
+			result.skillWeights[Skill::kSpeechcraft] = weights.speech;
+			result.skillWeights[Skill::kAlteration] = weights.alteration;
+			result.skillWeights[Skill::kConjuration] = weights.conjuration;
+			result.skillWeights[Skill::kDestruction] = weights.destruction;
+			result.skillWeights[Skill::kIllusion] = weights.illusion;
+			result.skillWeights[Skill::kRestoration] = weights.restoration;
+			result.skillWeights[Skill::kEnchanting] = weights.enchanting;
+		}
+
+		const auto set_trait = [&](TraitFlags a_flag, bool a_value) {
+			if (a_value) {
+				result.traits |= a_flag;
+			}
+		};
+
+		set_trait(kFemale, npc->GetSex() == RE::SEX::kFemale);
+		set_trait(kUnique, npc->IsUnique());
+		set_trait(kSummonable, npc->IsSummonable());
+		set_trait(kChild, IsChild());
+		set_trait(kLeveled, IsLeveled());
+		set_trait(kTeammate, IsTeammate());
+		set_trait(kDead, IsDead());
 	}
 
 	RE::TESNPC* Data::GetNPC() const
@@ -83,40 +174,181 @@ namespace NPC
 		return actor;
 	}
 
-	bool Data::has_keyword_string(const std::string& a_string) const
+	bool Data::has_keyword_string(std::string_view a_string) const
 	{
-		return std::any_of(keywords.begin(), keywords.end(), [&](const auto& keyword) {
-			return string::iequals(keyword, a_string);
-		});
+		// Keyword EditorIDs are short, so they are folded on the stack rather than into a new string for every lookup.
+		std::array<char, 256> buffer;
+		if (a_string.size() > buffer.size()) {
+			return get_keywords().contains(CaseFold::folded(a_string));
+		}
+		return get_keywords().contains(CaseFold::folded(a_string, buffer));
 	}
 
-	bool Data::HasStringFilter(const StringVec& a_strings, bool a_all) const
+	void Data::insert_atom(Strings& a_strings, std::optional<Atom> a_atom)
 	{
+		// Strings that were never interned can't be referenced by any String Filter, so they are not tracked.
+		if (a_atom) {
+			a_strings.atoms.insert(*a_atom);
+		}
+	}
+
+	bool Data::HasStringFilter(std::span<const Atom> a_strings, bool a_all) const
+	{
+		const auto& atoms = get_strings().atoms;
 		if (a_all) {
-			return std::ranges::all_of(a_strings, [&](const auto& str) {
-				return has_keyword_string(str) || string::iequals(name, str) || std::ranges::any_of(IDs, [&](const auto& ID) { return ID == str; });
-			});
+			return atoms.contains_all(a_strings);
 		} else {
-			return std::ranges::any_of(a_strings, [&](const auto& str) {
-				return has_keyword_string(str) || string::iequals(name, str) || std::ranges::any_of(IDs, [&](const auto& ID) { return ID == str; });
-			});
+			return atoms.contains_any(a_strings);
 		}
 	}
 
-	bool Data::ContainsStringFilter(const StringVec& a_strings) const
+	bool Data::ContainsStringFilter(std::span<const Pattern> a_patterns) const
 	{
-		return std::ranges::any_of(a_strings, [&](const auto& str) {
-			return string::icontains(name, str) ||
-			       std::ranges::any_of(IDs, [&](const auto& ID) { return ID.contains(str); }) ||
-			       std::any_of(keywords.begin(), keywords.end(), [&](const auto& keyword) {
-					   return string::icontains(keyword, str);
-				   });
-		});
+		return get_strings().patterns.contains_any(a_patterns);
 	}
 
-	bool Data::InsertKeyword(const char* a_keyword)
+	bool Data::InsertKeyword(const RE::BGSKeyword* a_keyword)
 	{
-		return keywords.emplace(a_keyword).second;
+		// Keyword is not added to NPC until the end of distribution, so lazy fields must be computed before it is recorded in them.
+		get_keywords();
+		get_strings();
+
+		insert_atom(*strings, Atoms::Find(a_keyword));
+		Patterns::matcher.Match(a_keyword, strings->patterns);
+		if (keywords->emplace(CaseFold::folded(a_keyword->GetFormEditorID())).second) {
+			ClearVerdicts();
+			return true;
+		}
+		return false;
+	}
+
+	std::optional<Data::MemberType> Data::get_member_type(const RE::TESForm* a_form)
+	{
+		switch (a_form->GetFormType()) {
+		case RE::FormType::Faction:
+			return MemberType::kFaction;
+		case RE::FormType::Spell:
+			return MemberType::kSpell;
+		case RE::FormType::LeveledSpell:
+			return MemberType::kLevSpell;
+		case RE::FormType::Perk:
+			return MemberType::kPerk;
+		case RE::FormType::Shout:
+			return MemberType::kShout;
+		case RE::FormType::Package:
+			return MemberType::kPackage;
+		default:
+			return std::nullopt;
+		}
+	}
+
+	const Set<RE::FormID>& Data::get_members(MemberType a_type) const
+	{
+		auto& set = members[static_cast<std::size_t>(a_type)];
+		if (set) {
+			return *set;
+		}
+
+		auto& forms = set.emplace();
+
+		const auto insert = [&](const auto* a_form) {
+			if (a_form) {
+				forms.insert(a_form->GetFormID());
+			}
+		};
+
+		const auto insert_array = [&](auto* const* a_array, std::uint32_t a_count) {
+			if (a_array) {
+				for (std::uint32_t i = 0; i < a_count; ++i) {
+					insert(a_array[i]);
+				}
+			}
+		};
+
+		switch (a_type) {
+		case MemberType::kFaction:
+			for (const auto& factionRank : npc->factions) {
+				// Leveled distribution reverts factions by setting their rank to -1, and TESNPC::IsInFaction doesn't count such factions either.
+				if (factionRank.rank > -1) {
+					insert(factionRank.faction);
+				}
+			}
+			break;
+		case MemberType::kSpell:
+			if (const auto spellList = npc->GetSpellList()) {
+				insert_array(spellList->spells, spellList->numSpells);
+			}
+			break;
+		case MemberType::kLevSpell:
+			if (const auto spellList = npc->GetSpellList()) {
+				insert_array(spellList->levSpells, spellList->numlevSpells);
+			}
+			break;
+		case MemberType::kShout:
+			if (const auto spellList = npc->GetSpellList()) {
+				insert_array(spellList->shouts, spellList->numShouts);
+			}
+			break;
+		case MemberType::kPerk:
+			if (npc->perks) {
+				for (std::uint32_t i = 0; i < npc->perkCount; ++i) {
+					insert(npc->perks[i].perk);
+				}
+			}
+			break;
+		case MemberType::kPackage:
+			for (const auto package : npc->aiPackages.packages) {
+				insert(package);
+			}
+			break;
+		default:
+			break;
+		}
+
+		return forms;
+	}
+
+	bool Data::HasMember(const RE::TESForm* a_form) const
+	{
+		if (const auto type = get_member_type(a_form)) {
+			return get_members(*type).contains(a_form->GetFormID());
+		}
+		return false;
+	}
+
+	void Data::InsertMember(const RE::TESForm* a_form)
+	{
+		if (const auto type = get_member_type(a_form)) {
+			// Form is not added to NPC until the plan is applied, so the set must be collected before the form is recorded in it.
+			get_members(*type);
+			members[static_cast<std::size_t>(*type)]->insert(a_form->GetFormID());
+		}
+	}
+
+	const Set<RE::FormID>& Data::GetFactions() const
+	{
+		return get_members(MemberType::kFaction);
+	}
+
+	std::optional<bool> Data::GetVerdict(std::uint32_t a_programID) const
+	{
+		if (a_programID < verdicts.size() && verdicts[a_programID] != 0) {
+			return verdicts[a_programID] == 2;
+		}
+		return std::nullopt;
+	}
+
+	void Data::SetVerdict(std::uint32_t a_programID, bool a_passed) const
+	{
+		if (a_programID >= verdicts.size()) {
+			verdicts.resize(std::max<std::size_t>(a_programID + 1, Filter::programs.GetSize()), 0);
+		}
+		verdicts[a_programID] = a_passed ? 2 : 1;
+	}
+
+	void Data::ClearVerdicts() const
+	{
+		std::ranges::fill(verdicts, 0);
 	}
 
 	bool Data::has_form(RE::TESForm* a_form) const
@@ -127,23 +359,19 @@ namespace NPC
 		case RE::FormType::Class:
 			return npc->npcClass == a_form;
 		case RE::FormType::Faction:
-			{
-				const auto faction = a_form->As<RE::TESFaction>();
-				return npc->IsInFaction(faction);
-			}
+		case RE::FormType::Spell:
+			return HasMember(a_form);
+		case RE::FormType::Perk:
+			// Actor's own perks (e.g. ones that the player added) count too, not only the ones of its base.
+			return HasMember(a_form) || actor->HasPerk(a_form->As<RE::BGSPerk>());
 		case RE::FormType::Race:
 			return GetRace() == a_form;
 		case RE::FormType::Outfit:
 			return Outfits::Manager::GetSingleton()->HasDefaultOutfit(npc, a_form->As<RE::BGSOutfit>());
 		case RE::FormType::NPC:
-			return npc == a_form || std::ranges::any_of(IDs, [&](const auto& ID) { return ID == a_form->GetFormID(); });
+			return npc == a_form || std::ranges::any_of(get_IDs(), [&](const auto& ID) { return ID == a_form->GetFormID(); });
 		case RE::FormType::VoiceType:
 			return npc->voiceType == a_form;
-		case RE::FormType::Spell:
-			{
-				const auto spell = a_form->As<RE::SpellItem>();
-				return npc->GetSpellList()->GetIndex(spell).has_value();
-			}
 		case RE::FormType::Armor:
 			return npc->skin == a_form;
 		case RE::FormType::Location:
@@ -151,31 +379,48 @@ namespace NPC
 				const auto location = a_form->As<RE::BGSLocation>();
 				return actor->GetEditorLocation() == location;
 			}
-		case RE::FormType::Perk:
-			{
-				const auto perk = a_form->As<RE::BGSPerk>();
-				return actor->HasPerk(perk);
-			}
 		case RE::FormType::FormList:
 			{
-				bool result = false;
-
-				const auto list = a_form->As<RE::BGSListForm>();
-				list->ForEachForm([&](RE::TESForm* a_formInList) {
-					if (result = has_form(a_formInList); result) {
-						return RE::BSContainer::ForEachResult::kStop;
-					}
-					return RE::BSContainer::ForEachResult::kContinue;
-				});
-
-				return result;
+				const auto flattened = FormLists::Manager::GetSingleton()->Get(a_form->As<RE::BGSListForm>());
+				return std::ranges::any_of(flattened->groups, [&](const auto& a_group) { return has_any_form(a_group); });
 			}
 		default:
 			return false;
 		}
 	}
 
-	bool Data::HasFormFilter(const FormVec& a_forms, bool all) const
+	bool Data::has_any_form(const FormLists::Flattened::Group& a_group) const
+	{
+		using FormLists::Flattened;
+
+		const auto& [type, forms] = a_group;
+
+		switch (type) {
+		case RE::FormType::CombatStyle:
+			return Flattened::Contains(a_group, npc->GetCombatStyle());
+		case RE::FormType::Class:
+			return Flattened::Contains(a_group, npc->npcClass);
+		case RE::FormType::Race:
+			return Flattened::Contains(a_group, GetRace());
+		case RE::FormType::VoiceType:
+			return Flattened::Contains(a_group, npc->voiceType);
+		case RE::FormType::Armor:
+			return Flattened::Contains(a_group, npc->skin);
+		case RE::FormType::Faction:
+			return std::ranges::any_of(get_members(MemberType::kFaction), [&](RE::FormID a_factionID) {
+				return std::ranges::binary_search(forms, a_factionID, {}, &RE::TESForm::GetFormID);
+			});
+		case RE::FormType::NPC:
+			return Flattened::Contains(a_group, npc) || std::ranges::any_of(get_IDs(), [&](const auto& ID) {
+				return std::ranges::binary_search(forms, ID.formID, {}, &RE::TESForm::GetFormID);
+			});
+		default:
+			// Spells, perks, outfits and locations can't be probed with a single form of NPC.
+			return std::ranges::any_of(forms, [&](RE::TESForm* a_form) { return has_form(a_form); });
+		}
+	}
+
+	bool Data::HasFormFilter(std::span<const FormOrMod> a_forms, bool all) const
 	{
 		const auto has_form_or_file = [&](const std::variant<RE::TESForm*, const RE::TESFile*>& a_formFile) {
 			bool result = false;
@@ -184,7 +429,7 @@ namespace NPC
 							   result = has_form(a_form);
 						   },
 						   [&](const RE::TESFile* a_file) {
-							   result = std::ranges::any_of(IDs, [&](const auto& ID) { return ID == a_file; });
+							   result = std::ranges::any_of(get_IDs(), [&](const auto& ID) { return ID == a_file; });
 						   } },
 				a_formFile);
 			return result;
@@ -228,7 +473,11 @@ namespace NPC
 
 	bool Data::IsTeammate() const
 	{
-		return teammate;
+		if (!teammate) {
+			std::call_once(init, [&] { potentialFollowerFaction = RE::TESForm::LookupByID<RE::TESFaction>(0x0005C84D); });
+			teammate = actor->IsPlayerTeammate() || potentialFollowerFaction && npc->IsInFaction(potentialFollowerFaction);
+		}
+		return *teammate;
 	}
 
 	bool Data::IsDead() const
@@ -260,4 +509,17 @@ namespace NPC
 	{
 		return race;
 	}
+
+	const Atoms::Set& Data::GetStrings() const
+	{
+		return get_strings().atoms;
+	}
+
+	const Features& Data::GetFeatures() const
+	{
+		if (!features) {
+			init_features();
+		}
+		return *features;
+	}
 }
@@ -1,10 +1,49 @@
 #pragma once
 
+#include "Atoms.h"
+#include "FormLists.h"
+#include "Patterns.h"
+#include "RecordCache.h"
+
 namespace NPC
 {
 	inline std::once_flag  init;
 	inline RE::TESFaction* potentialFollowerFaction;
 
+	/// Flags of boolean traits of NPC that are checked by Trait Filters.
+	enum TraitFlags : std::uint8_t
+	{
+		kNone = 0,
+		kFemale = 1 << 0,
+		kUnique = 1 << 1,
+		kSummonable = 1 << 2,
+		kChild = 1 << 3,
+		kLeveled = 1 << 4,
+		kTeammate = 1 << 5,
+		kDead = 1 << 6,
+		kNever = 1 << 7  // Never set for NPCs. Required by masks of trait filters that can't pass.
+	};
+
+	/// <summary>
+	/// Plain values of NPC that are checked by Level and Trait Filters.
+	///
+	/// Features are extracted once when NPC::Data is created,
+	/// so that filters can compare them directly instead of querying NPC for every entry.
+	/// </summary>
+	struct Features
+	{
+		static constexpr std::size_t skillCount = 18;
+		static constexpr std::size_t skillStride = 32;  // Skill arrays are padded with zeros to whole SIMD registers.
+
+		using Skills = std::array<std::uint8_t, skillStride>;
+
+		alignas(16) Skills skills{};        // skill levels indexed by RE::TESNPC::Skills
+		alignas(16) Skills skillWeights{};  // skill weights of NPC's class indexed by RE::TESNPC::Skills
+		std::uint16_t level{ 0 };
+		std::uint8_t  traits{ kNone };  // combination of TraitFlags
+		bool          hasClass{ false };
+	};
+
 	struct Data
 	{
 		Data(RE::Actor* a_actor, bool isDying = false);
@@ -14,10 +53,10 @@ namespace NPC
 		[[nodiscard]] RE::TESNPC* GetNPC() const;
 		[[nodiscard]] RE::Actor*  GetActor() const;
 
-		[[nodiscard]] bool HasStringFilter(const StringVec& a_strings, bool a_all = false) const;
-		[[nodiscard]] bool ContainsStringFilter(const StringVec& a_strings) const;
-		bool               InsertKeyword(const char* a_keyword);
-		[[nodiscard]] bool HasFormFilter(const FormVec& a_forms, bool all = false) const;
+		[[nodiscard]] bool HasStringFilter(std::span<const Atom> a_strings, bool a_all = false) const;
+		[[nodiscard]] bool ContainsStringFilter(std::span<const Pattern> a_patterns) const;
+		bool               InsertKeyword(const RE::BGSKeyword* a_keyword);
+		[[nodiscard]] bool HasFormFilter(std::span<const FormOrMod> a_forms, bool all = false) const;
 
 		/// <summary>
 		/// Checks whether given NPC already has another form that is mutually exclusive with the given form,
@@ -55,6 +94,50 @@ namespace NPC
 
 		[[nodiscard]] RE::TESRace* GetRace() const;
 
+		[[nodiscard]] const Features& GetFeatures() const;
+
+		/// Atoms of all strings that are matched by String Filters.
+		[[nodiscard]] const Atoms::Set& GetStrings() const;
+
+		/// <summary>
+		/// Checks whether NPC has the given faction, spell, leveled spell, perk, shout or package.
+		///
+		/// Forms of each type are collected into a flat set the first time one of them is checked,
+		/// so that following checks don't scan engine arrays.
+		/// </summary>
+		[[nodiscard]] bool HasMember(const RE::TESForm* a_form) const;
+
+		/// Records a form that is planned to be added to NPC, so that following checks treat NPC as its member.
+		void InsertMember(const RE::TESForm* a_form);
+
+		/// FormIDs of factions that NPC is a member of, including those that are planned for it.
+		[[nodiscard]] const Set<RE::FormID>& GetFactions() const;
+
+		template <class Form>
+		void InsertMembers(const std::vector<Form*>& a_forms)
+		{
+			for (const auto form : a_forms) {
+				InsertMember(form);
+			}
+		}
+
+		/// Verdict of a filter Program with the given ID if it was already memoized for this NPC.
+		[[nodiscard]] std::optional<bool> GetVerdict(std::uint32_t a_programID) const;
+		void                              SetVerdict(std::uint32_t a_programID, bool a_passed) const;
+
+		/// Forgets all memoized verdicts.
+		/// Must be called whenever NPC receives forms that might change results of filters.
+		void ClearVerdicts() const;
+
+		/// Calls a_callback with FormID of each form that identifies this NPC (its templates or NPC itself).
+		template <typename Func>
+		void ForEachID(Func&& a_callback) const
+		{
+			for (const auto& ID : get_IDs()) {
+				a_callback(ID.formID);
+			}
+		}
+
 	private:
 		struct ID
 		{
@@ -62,30 +145,63 @@ namespace NPC
 			explicit ID(const RE::TESForm* a_base);
 			~ID() = default;
 
-			[[nodiscard]] bool contains(const std::string& a_str) const;
-
 			bool operator==(const RE::TESFile* a_mod) const;
-			bool operator==(const std::string& a_str) const;
 			bool operator==(RE::FormID a_formID) const;
 
-			RE::FormID  formID{ 0 };
-			std::string editorID{};
+			const RE::TESForm* form{ nullptr };
+			RE::FormID         formID{ 0 };
 		};
 
-		[[nodiscard]] bool has_keyword_string(const std::string& a_string) const;
+		/// Atoms and Patterns of NPC's keywords, name and EditorIDs of templates.
+		struct Strings
+		{
+			Atoms::Set    atoms{};
+			Patterns::Set patterns{};
+		};
+
+		[[nodiscard]] bool has_keyword_string(std::string_view a_string) const;
 		[[nodiscard]] bool has_form(RE::TESForm* a_form) const;
+		[[nodiscard]] bool has_any_form(const FormLists::Flattened::Group& a_group) const;
+
+		enum class MemberType : std::uint8_t
+		{
+			kFaction,
+			kSpell,
+			kLevSpell,
+			kPerk,
+			kShout,
+			kPackage,
+
+			kTotal
+		};
 
-		RE::TESNPC*     npc;
-		RE::Actor*      actor;
-		RE::TESRace*    race;
-		std::vector<ID> IDs;
-		std::string     name;
-		StringSet       keywords{};
-		std::uint16_t   level;
-		bool            child;
-		bool            teammate;
-		bool            leveled;
-		bool            dying;
+		[[nodiscard]] static std::optional<MemberType> get_member_type(const RE::TESForm* a_form);
+		[[nodiscard]] const Set<RE::FormID>&            get_members(MemberType a_type) const;
+
+		// Expensive fields are computed on first access, so that NPCs that no filter looks at don't pay for them.
+		[[nodiscard]] const std::vector<ID>& get_IDs() const;
+		[[nodiscard]] const StringSet&       get_keywords() const;
+		[[nodiscard]] const Strings&         get_strings() const;
+
+		static void insert_atom(Strings& a_strings, std::optional<Atom> a_atom);
+		void        init_features() const;
+
+		RE::TESNPC*   npc;
+		RE::Actor*    actor;
+		RE::TESRace*  race;
+		std::uint16_t level;
+		bool          child;
+		bool          leveled;
+		bool          dying;
+
+		mutable std::optional<std::vector<ID>> IDs{};
+		mutable std::optional<StringSet>       keywords{};  // Folded EditorIDs of NPC's and race's keywords.
+		mutable std::optional<Strings>         strings{};
+		mutable std::optional<bool>            teammate{};
+		mutable std::optional<Features>        features{};
+
+		mutable std::array<std::optional<Set<RE::FormID>>, static_cast<std::size_t>(MemberType::kTotal)> members{};  // Collected on first use.
+		mutable std::vector<std::uint8_t>                                                                verdicts{};  // Memoized Program results indexed by Program IDs: 0 - unknown, 1 - failed, 2 - passed.
 	};
 }
 
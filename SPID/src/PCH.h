@@ -3,6 +3,7 @@
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
 
+#include <emmintrin.h>
 #include <ranges>
 #include <shared_mutex>
 
@@ -39,17 +39,13 @@ namespace PCLevelMult
 
 	bool Manager::FindRejectedEntry(const Input& a_input, RE::FormID a_distributedFormID, std::uint32_t a_formDataIndex) const
 	{
+		// Chance is rolled from the same stream for an actor and an entry at every level, so a rejection holds for all levels.
 		ReadLocker lock(_lock);
-		if (const auto idIt = _cache.find(a_input.playerID); idIt != _cache.end()) {
-			auto& npcFormIDMap = idIt->second;
-			if (const auto npcIt = npcFormIDMap.find(a_input.npcFormID); npcIt != npcFormIDMap.end()) {
-				for (const auto& [level, cachedData] : npcIt->second.entries) {
-					if (a_input.npcLevel >= level) {
-						if (const auto formIt = cachedData.rejectedEntries.find(a_distributedFormID); formIt != cachedData.rejectedEntries.end()) {
-							return formIt->second.contains(a_formDataIndex);
-						}
-					}
-				}
+		if (const auto index = find_entry_index(a_distributedFormID, a_formDataIndex)) {
+			if (const auto it = _cache.find(get_key(a_input.playerID, a_input.npcFormID)); it != _cache.end()) {
+				const auto& rejectedEntries = it->second.rejectedEntries;
+				const auto  word = *index / 64;
+				return word < rejectedEntries.size() && (rejectedEntries[word] & (1ull << (*index % 64))) != 0;
 			}
 		}
 
@@ -59,29 +55,34 @@ namespace PCLevelMult
 	bool Manager::InsertRejectedEntry(const Input& a_input, RE::FormID a_distributedFormID, std::uint32_t a_formDataIndex)
 	{
 		WriteLocker lock(_lock);
-		return _cache[a_input.playerID]
-		             [a_input.npcFormID]
-		                 .entries[a_input.npcLevel]
-		                 .rejectedEntries[a_distributedFormID]
-		                 .insert(a_formDataIndex)
-		                 .second;
+		const auto  index = get_entry_index(a_distributedFormID, a_formDataIndex);
+
+		auto&      rejectedEntries = _cache[get_key(a_input.playerID, a_input.npcFormID)].rejectedEntries;
+		const auto word = index / 64;
+		if (word >= rejectedEntries.size()) {
+			rejectedEntries.resize(word + 1);
+		}
+
+		const auto bit = 1ull << (index % 64);
+		if (rejectedEntries[word] & bit) {
+			return false;
+		}
+		rejectedEntries[word] |= bit;
+		return true;
 	}
 
 	void Manager::DumpRejectedEntries()
 	{
 		ReadLocker lock(_lock);
-		for (auto& [playerID, npcFormIDs] : _cache) {
-			logger::info("PlayerID : {:X}", playerID);
-			for (auto& [npcFormID, levelMap] : npcFormIDs) {
-				logger::info("\tNPC : {} [{:X}]", editorID::get_editorID(RE::TESForm::LookupByID(npcFormID)), npcFormID);
-				for (auto& [level, distFormMap] : levelMap.entries) {
-					logger::info("\t\tLevel : {}", level);
-					for (auto& [distFormID, idxSet] : distFormMap.rejectedEntries) {
-						logger::info("\t\t\tDist FormID : {} [{:X}]", editorID::get_editorID(RE::TESForm::LookupByID(distFormID)), distFormID);
-						for (auto& idx : idxSet) {
-							logger::info("\t\t\t\tIDX : {}", idx);
-						}
-					}
+		for (auto& [key, data] : _cache) {
+			const auto npcFormID = static_cast<RE::FormID>(key);
+			logger::info("PlayerID : {:X}", key >> 32);
+			logger::info("\tNPC : {} [{:X}]", editorID::get_editorID(RE::TESForm::LookupByID(npcFormID)), npcFormID);
+			for (std::uint32_t word = 0; word < data.rejectedEntries.size(); ++word) {
+				for (auto bits = data.rejectedEntries[word]; bits != 0; bits &= bits - 1) {
+					const auto entry = _entries[word * 64 + std::countr_zero(bits)];
+					const auto distFormID = static_cast<RE::FormID>(entry >> 32);
+					logger::info("\t\tDist FormID : {} [{:X}] IDX : {}", editorID::get_editorID(RE::TESForm::LookupByID(distFormID)), distFormID, static_cast<std::uint32_t>(entry));
 				}
 			}
 		}
@@ -90,10 +91,8 @@ namespace PCLevelMult
 	bool Manager::FindDistributedEntry(const Input& a_input)
 	{
 		ReadLocker lock(_lock);
-		if (const auto it = _cache.find(a_input.playerID); it != _cache.end()) {
-			if (const auto npcIt = it->second.find(a_input.npcFormID); npcIt != it->second.end()) {
-				return !npcIt->second.entries.empty();
-			}
+		if (const auto it = _cache.find(get_key(a_input.playerID, a_input.npcFormID)); it != _cache.end()) {
+			return !it->second.levels.empty() || !it->second.rejectedEntries.empty();
 		}
 		return false;
 	}
@@ -101,55 +100,102 @@ namespace PCLevelMult
 	void Manager::InsertDistributedEntry(const Input& a_input, RE::FormType a_formType, const Set<RE::FormID>& a_formIDSet)
 	{
 		WriteLocker lock(_lock);
-		_cache[a_input.playerID][a_input.npcFormID].entries[a_input.npcLevel].distributedEntries[a_formType].insert(a_formIDSet.begin(), a_formIDSet.end());
+		auto&       levels = _cache[get_key(a_input.playerID, a_input.npcFormID)].levels;
+
+		auto it = std::ranges::lower_bound(levels, a_input.npcLevel, {}, &Level::level);
+		if (it == levels.end() || it->level != a_input.npcLevel) {
+			it = levels.insert(it, Level{ a_input.npcLevel });
+		}
+
+		auto& entries = it->distributedEntries;
+		for (const auto& formID : a_formIDSet) {
+			entries.push_back({ a_formType, formID });
+		}
+		std::ranges::sort(entries);
+		const auto [first, last] = std::ranges::unique(entries);
+		entries.erase(first, last);
 	}
 
 	void Manager::DumpDistributedEntries()
 	{
 		ReadLocker lock(_lock);
-		for (const auto& [playerID, npcFormIDs] : _cache) {
-			logger::info("PlayerID : {:X}", playerID);
-			for (const auto& [npcFormID, levelMap] : npcFormIDs) {
-				logger::info("\tNPC : {} [{:X}]", editorID::get_editorID(RE::TESForm::LookupByID(npcFormID)), npcFormID);
-				for (const auto& [level, distFormMap] : levelMap.entries) {
-					logger::info("\t\tLevel : {}", level);
-					for (const auto& [formType, formIDSet] : distFormMap.distributedEntries) {
-						logger::info("\t\t\tDist FormType : {}", formType);
-						for (const auto& formID : formIDSet) {
-							logger::info("\t\t\t\tDist FormID : {} [{:X}]", editorID::get_editorID(RE::TESForm::LookupByID(formID)), formID);
-						}
-					}
+		for (const auto& [key, data] : _cache) {
+			const auto npcFormID = static_cast<RE::FormID>(key);
+			logger::info("PlayerID : {:X}", key >> 32);
+			logger::info("\tNPC : {} [{:X}]", editorID::get_editorID(RE::TESForm::LookupByID(npcFormID)), npcFormID);
+			for (const auto& [level, distributedEntries] : data.levels) {
+				logger::info("\t\tLevel : {}", level);
+				for (const auto& [formType, formID] : distributedEntries) {
+					logger::info("\t\t\tDist FormType : {} Dist FormID : {} [{:X}]", formType, editorID::get_editorID(RE::TESForm::LookupByID(formID)), formID);
 				}
 			}
 		}
 	}
 
-	void Manager::ForEachDistributedEntry(const Input& a_input, bool a_onlyValidEntries, std::function<void(RE::FormType, const Set<RE::FormID>&)> a_fn) const
+	void Manager::ForEachDistributedEntry(const Input& a_input, bool a_onlyValidEntries, std::function<void(RE::FormType, std::span<const RE::FormID>)> a_fn) const
 	{
-		ReadLocker lock(_lock);
-		if (const auto pcIt = _cache.find(a_input.playerID); pcIt != _cache.end()) {
-			auto& npcFormIDMap = pcIt->second;
-			if (const auto npcIt = npcFormIDMap.find(a_input.npcFormID); npcIt != npcFormIDMap.end()) {
-				for (const auto& [level, cachedData] : npcIt->second.entries) {
+		std::vector<DistributedEntry> entries{};
+		{
+			ReadLocker lock(_lock);
+			if (const auto it = _cache.find(get_key(a_input.playerID, a_input.npcFormID)); it != _cache.end()) {
+				for (const auto& [level, distributedEntries] : it->second.levels) {
 					if (a_onlyValidEntries && a_input.npcLevel < level) {
-						continue;
-					}
-					for (auto& [formType, entries] : cachedData.distributedEntries) {
-						a_fn(formType, entries);
+						break;
 					}
+					entries.insert(entries.end(), distributedEntries.begin(), distributedEntries.end());
 				}
 			}
 		}
+
+		// Forms of all levels are grouped by type, so that each type is reported once.
+		std::ranges::sort(entries);
+
+		std::vector<RE::FormID> formIDs{};
+		for (auto first = entries.begin(); first != entries.end();) {
+			const auto last = std::find_if(first, entries.end(), [&](const auto& a_entry) { return a_entry.type != first->type; });
+
+			formIDs.clear();
+			for (auto it = first; it != last; ++it) {
+				if (formIDs.empty() || formIDs.back() != it->formID) {
+					formIDs.push_back(it->formID);
+				}
+			}
+			a_fn(first->type, formIDs);
+
+			first = last;
+		}
+	}
+
+	std::optional<std::uint16_t> Manager::FindDistributedLevel(const Input& a_input) const
+	{
+		ReadLocker lock(_lock);
+		if (const auto it = _cache.find(get_key(a_input.playerID, a_input.npcFormID)); it != _cache.end() && it->second.distributedLevel != 0) {
+			return it->second.distributedLevel;
+		}
+		return std::nullopt;
+	}
+
+	void Manager::SetDistributedLevel(const Input& a_input)
+	{
+		WriteLocker lock(_lock);
+		_cache[get_key(a_input.playerID, a_input.npcFormID)].distributedLevel = a_input.npcLevel;
+	}
+
+	void Manager::ClearDistributedLevel(const Input& a_input)
+	{
+		WriteLocker lock(_lock);
+		if (const auto it = _cache.find(get_key(a_input.playerID, a_input.npcFormID)); it != _cache.end()) {
+			it->second.distributedLevel = 0;
+		}
 	}
 
 	// For spawned actors with FF reference IDs
 	void Manager::DeleteNPC(RE::FormID a_characterID)
 	{
+		const auto key = get_key(GetSingleton()->GetCurrentPlayerID(), a_characterID);
+
 		WriteLocker lock(_lock);
-		auto&       currentCache = _cache[GetSingleton()->GetCurrentPlayerID()];
-		if (const auto it = currentCache.find(a_characterID); it != currentCache.end()) {
-			currentCache.erase(it);
-		}
+		_cache.erase(key);
 	}
 
 	bool Manager::HasHitLevelCap(const Input& a_input)
@@ -157,9 +203,9 @@ namespace PCLevelMult
 		bool hitCap = (a_input.npcLevel == a_input.npcLevelCap);
 
 		WriteLocker lock(_lock);
-		auto&       map = _cache[a_input.playerID];
-		if (const auto it = map.find(a_input.npcFormID); it == map.end()) {
-			map[a_input.npcFormID].levelCapState = static_cast<LEVEL_CAP_STATE>(hitCap);
+		auto [it, inserted] = _cache.try_emplace(get_key(a_input.playerID, a_input.npcFormID));
+		if (inserted) {
+			it->second.levelCapState = static_cast<LEVEL_CAP_STATE>(hitCap);
 		} else {
 			auto& levelCapState = it->second.levelCapState;
 			if (hitCap) {
@@ -215,10 +261,43 @@ namespace PCLevelMult
 	void Manager::remap_player_ids(std::uint64_t a_oldID, std::uint64_t a_newID)
 	{
 		WriteLocker lock(_lock);
-		if (!_cache.contains(a_newID)) {
-			if (const auto it = _cache.find(a_oldID); it != _cache.end()) {
-				_cache[a_newID] = it->second;
+		const auto  has_player = [&](std::uint64_t a_playerID) {
+			return std::ranges::any_of(_cache, [&](const auto& a_pair) { return a_pair.first >> 32 == a_playerID; });
+		};
+
+		if (!has_player(a_newID)) {
+			std::vector<std::pair<std::uint64_t, Data>> remapped{};
+			for (const auto& [key, data] : _cache) {
+				if (key >> 32 == a_oldID) {
+					remapped.emplace_back(get_key(a_newID, static_cast<RE::FormID>(key)), data);
+				}
+			}
+			for (auto& [key, data] : remapped) {
+				_cache.emplace(key, std::move(data));
 			}
 		}
 	}
+
+	std::uint64_t Manager::get_key(std::uint64_t a_playerID, RE::FormID a_npcFormID)
+	{
+		return a_playerID << 32 | a_npcFormID;
+	}
+
+	std::optional<std::uint32_t> Manager::find_entry_index(RE::FormID a_distributedFormID, std::uint32_t a_formDataIndex) const
+	{
+		if (const auto it = _entryIndices.find(static_cast<std::uint64_t>(a_distributedFormID) << 32 | a_formDataIndex); it != _entryIndices.end()) {
+			return it->second;
+		}
+		return std::nullopt;
+	}
+
+	std::uint32_t Manager::get_entry_index(RE::FormID a_distributedFormID, std::uint32_t a_formDataIndex)
+	{
+		const auto entry = static_cast<std::uint64_t>(a_distributedFormID) << 32 | a_formDataIndex;
+		const auto [it, inserted] = _entryIndices.try_emplace(entry, static_cast<std::uint32_t>(_entries.size()));
+		if (inserted) {
+			_entries.push_back(entry);
+		}
+		return it->second;
+	}
 }
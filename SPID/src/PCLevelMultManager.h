@@ -27,9 +27,14 @@ namespace PCLevelMult
 
 		[[nodiscard]] bool FindDistributedEntry(const Input& a_input);
 		void               InsertDistributedEntry(const Input& a_input, RE::FormType a_formType, const Set<RE::FormID>& a_formIDSet);
-		void               ForEachDistributedEntry(const Input& a_input, bool a_onlyValidEntries, std::function<void(RE::FormType, const Set<RE::FormID>&)> a_fn) const;
+		void               ForEachDistributedEntry(const Input& a_input, bool a_onlyValidEntries, std::function<void(RE::FormType, std::span<const RE::FormID>)> a_fn) const;
 		void               DumpDistributedEntries();
 
+		/// Level of NPC that all entries with Level Filters were last evaluated at, if they were.
+		[[nodiscard]] std::optional<std::uint16_t> FindDistributedLevel(const Input& a_input) const;
+		void                                       SetDistributedLevel(const Input& a_input);
+		void                                       ClearDistributedLevel(const Input& a_input);
+
 		void DeleteNPC(RE::FormID a_characterID);
 		bool HasHitLevelCap(const Input& a_input);
 
@@ -45,18 +50,36 @@ namespace PCLevelMult
 			kHit
 		};
 
+		/// A form that was distributed to NPC at some level.
+		struct DistributedEntry
+		{
+			RE::FormType type{};
+			RE::FormID   formID{ 0 };
+
+			auto operator<=>(const DistributedEntry&) const = default;
+		};
+
+		struct Level
+		{
+			std::uint16_t                 level{ 0 };
+			std::vector<DistributedEntry> distributedEntries{};  // Sorted by type and formID
+		};
+
 		struct Data
 		{
-			struct Entries
-			{
-				Map<RE::FormID, Set<std::uint32_t>> rejectedEntries{};     // Distributed formID, FormData vector index
-				Map<RE::FormType, Set<RE::FormID>>  distributedEntries{};  // formtype, distributed formID
-			};
-
-			LEVEL_CAP_STATE             levelCapState{};
-			Map<std::uint16_t, Entries> entries{};  // Actor Level, Entries
+			LEVEL_CAP_STATE            levelCapState{};
+			std::uint16_t              distributedLevel{ 0 };  // Level that leveled entries were last evaluated at, 0 if they weren't
+			std::vector<Level>         levels{};               // Sorted by level, only levels at which something was distributed
+			std::vector<std::uint64_t> rejectedEntries{};      // Bitset of dense entry indices that failed their chance roll
 		};
 
+		/// Packs IDs of a player and an NPC into a key of _cache. Player IDs are 32-bit, see get_game_playerID.
+		[[nodiscard]] static std::uint64_t get_key(std::uint64_t a_playerID, RE::FormID a_npcFormID);
+
+		/// Dense index of the entry that a distributed form comes from, if it was ever rejected.
+		[[nodiscard]] std::optional<std::uint32_t> find_entry_index(RE::FormID a_distributedFormID, std::uint32_t a_formDataIndex) const;
+		std::uint32_t                              get_entry_index(RE::FormID a_distributedFormID, std::uint32_t a_formDataIndex);
+
 		static std::uint64_t get_game_playerID();
 		void                 remap_player_ids(std::uint64_t a_oldID, std::uint64_t a_newID);
 
@@ -67,9 +90,13 @@ namespace PCLevelMult
 		std::uint64_t oldPlayerID{ 0 };
 		bool          newGameStarted{ false };
 
-		mutable Lock _lock;
-		Map<std::uint64_t,          // PlayerID
-			Map<RE::FormID, Data>>  // NPC formID, Data
+		mutable Lock        _lock;
+		Map<std::uint64_t,  // PlayerID and NPC formID, see get_key
+			Data>
 			_cache{};
+
+		// Entries are identified by a distributed formID and index of FormData. Rejection bitsets index them densely in order of first rejection.
+		Map<std::uint64_t, std::uint32_t> _entryIndices{};
+		std::vector<std::uint64_t>        _entries{};  // Dense index to packed formID and FormData index
 	};
 }
@@ -0,0 +1,35 @@
+#include "Paths.h"
+
+namespace Paths
+{
+	namespace
+	{
+		struct Table
+		{
+			StringMap<ID>    ids{ { Path{}, none } };
+			std::deque<Path> paths{ Path{} };  // Deque keeps references returned by Get valid while new paths are added.
+		};
+
+		Table& get_table()
+		{
+			static Table table{};
+			return table;
+		}
+	}
+
+	ID Intern(const Path& a_path)
+	{
+		auto& [ids, paths] = get_table();
+
+		const auto [it, inserted] = ids.try_emplace(a_path, static_cast<ID>(paths.size()));
+		if (inserted) {
+			paths.push_back(a_path);
+		}
+		return it->second;
+	}
+
+	const Path& Get(ID a_id)
+	{
+		return get_table().paths[a_id];
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+/// Paths of config files interned as small integer IDs.
+///
+/// Every distributed form remembers the config that it came from,
+/// so referring to configs by IDs keeps that bookkeeping free of string copies and comparisons.
+namespace Paths
+{
+	using ID = std::uint32_t;
+
+	/// ID of the empty path. Global linked forms are stored under it, since they don't belong to any particular config.
+	inline constexpr ID none = 0;
+
+	/// Returns an ID for the given path, assigning a new one if the path wasn't interned before.
+	/// Paths are interned during lookup only, so this doesn't synchronize access.
+	ID Intern(const Path& a_path);
+
+	/// Returns the path that is represented by the ID.
+	[[nodiscard]] const Path& Get(ID a_id);
+}
@@ -0,0 +1,99 @@
+#include "Patterns.h"
+
+namespace Patterns
+{
+	void Set::insert(Pattern a_pattern)
+	{
+		const auto word = a_pattern / 64;
+		if (word >= bits.size()) {
+			bits.resize(word + 1);
+		}
+		bits[word] |= 1ull << (a_pattern % 64);
+	}
+
+	void Set::merge(const Set& a_other)
+	{
+		if (bits.size() < a_other.bits.size()) {
+			bits.resize(a_other.bits.size());
+		}
+		for (std::size_t i = 0; i < a_other.bits.size(); ++i) {
+			bits[i] |= a_other.bits[i];
+		}
+	}
+
+	bool Set::contains(Pattern a_pattern) const
+	{
+		const auto word = a_pattern / 64;
+		return word < bits.size() && (bits[word] & (1ull << (a_pattern % 64))) != 0;
+	}
+
+	bool Set::contains_any(std::span<const Pattern> a_patterns) const
+	{
+		return !bits.empty() && std::ranges::any_of(a_patterns, [&](const auto pattern) { return contains(pattern); });
+	}
+
+	Pattern Matcher::Register(std::string_view a_pattern)
+	{
+		return patterns.Intern(a_pattern);
+	}
+
+	PatternVec Matcher::Register(const StringVec& a_patterns)
+	{
+		PatternVec result{};
+		result.reserve(a_patterns.size());
+		for (const auto& pattern : a_patterns) {
+			result.push_back(Register(pattern));
+		}
+		return result;
+	}
+
+	void Matcher::Build(RE::TESDataHandler* const a_dataHandler)
+	{
+		const auto size = patterns.GetSize();
+		if (size == builtSize) {
+			return;
+		}
+
+		std::vector<std::string_view> strings{};
+		strings.reserve(size);
+		for (Pattern pattern = 0; pattern < size; ++pattern) {
+			strings.emplace_back(patterns.GetString(pattern));
+		}
+
+		automaton = AhoCorasick(strings);
+		builtSize = size;
+
+		keywords.clear();
+
+		const auto& keywordArray = a_dataHandler->GetFormArray<RE::BGSKeyword>();
+		keywords.reserve(keywordArray.size());
+
+		for (const auto& keyword : keywordArray) {
+			if (keyword) {
+				auto& matches = keywords[keyword];
+				if (const auto edid = keyword->GetFormEditorID(); !string::is_empty(edid)) {
+					automaton.ForEachMatch(edid, [&](const Pattern pattern) { matches.push_back(pattern); });
+					std::ranges::sort(matches);
+					matches.erase(std::ranges::unique(matches).begin(), matches.end());
+				}
+			}
+		}
+
+		logger::info("\tCompiled {} partial string filters into {} states", size, automaton.size());
+	}
+
+	void Matcher::Match(std::string_view a_string, Set& a_set) const
+	{
+		automaton.ForEachMatch(a_string, [&](const Pattern pattern) { a_set.insert(pattern); });
+	}
+
+	void Matcher::Match(const RE::BGSKeyword* a_keyword, Set& a_set) const
+	{
+		ForEachMatch(a_keyword, [&](const Pattern pattern) { a_set.insert(pattern); });
+	}
+
+	std::size_t Matcher::GetSize() const
+	{
+		return patterns.GetSize();
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "AhoCorasick.h"
+#include "Atoms.h"
+
+/// Patterns are substrings used by *partial (ANY) String Filters.
+///
+/// All patterns are registered during lookup and compiled into a single AhoCorasick automaton,
+/// so that each string of an NPC is scanned only once, regardless of how many partial filters are there.
+namespace Patterns
+{
+	using Pattern = std::uint32_t;
+	using PatternVec = std::vector<Pattern>;
+
+	/// <summary>
+	/// A set of Patterns that were matched in strings of an NPC.
+	/// </summary>
+	class Set
+	{
+	public:
+		void insert(Pattern a_pattern);
+
+		/// Inserts all Patterns of another set.
+		void merge(const Set& a_other);
+
+		[[nodiscard]] bool contains(Pattern a_pattern) const;
+
+		/// Checks whether the set contains at least one of the given patterns.
+		[[nodiscard]] bool contains_any(std::span<const Pattern> a_patterns) const;
+
+	private:
+		std::vector<std::uint64_t> bits{};
+	};
+
+	/// <summary>
+	/// Registry of all Patterns and the automaton that matches them.
+	///
+	/// Patterns are registered while filters are being looked up.
+	/// Once lookup is done, Build compiles the automaton and the matcher is treated as read-only.
+	/// </summary>
+	class Matcher
+	{
+	public:
+		/// Returns a Pattern for the given string. Strings that are equal case-insensitively share the same Pattern.
+		Pattern    Register(std::string_view a_pattern);
+		PatternVec Register(const StringVec& a_patterns);
+
+		/// Compiles all registered patterns into the automaton and matches them against EditorIDs of all keywords.
+		/// Does nothing if no new patterns were registered since the last build.
+		void Build(RE::TESDataHandler* const);
+
+		/// Adds all Patterns that occur in the string to the set.
+		void Match(std::string_view a_string, Set& a_set) const;
+
+		/// Adds all Patterns that occur in keyword's EditorID to the set.
+		void Match(const RE::BGSKeyword* a_keyword, Set& a_set) const;
+
+		/// Calls a_callback with each Pattern that occurs in keyword's EditorID.
+		template <typename Callback>
+		void ForEachMatch(const RE::BGSKeyword* a_keyword, Callback&& a_callback) const
+		{
+			if (const auto it = keywords.find(a_keyword); it != keywords.end()) {
+				for (const auto pattern : it->second) {
+					a_callback(pattern);
+				}
+			} else {
+				// Keywords that were created after the build are matched by their EditorIDs.
+				if (const auto edid = a_keyword->GetFormEditorID(); !string::is_empty(edid)) {
+					automaton.ForEachMatch(edid, a_callback);
+				}
+			}
+		}
+
+		/// Number of registered patterns.
+		[[nodiscard]] std::size_t GetSize() const;
+
+	private:
+		Atoms::Table patterns{};
+		AhoCorasick  automaton{};
+		std::size_t  builtSize{ 0 };
+
+		/// Patterns that occur in EditorID of each keyword, computed once per build.
+		Map<const RE::BGSKeyword*, PatternVec> keywords{};
+	};
+
+	/// The matcher that is used by Filters and NPC Data.
+	inline Matcher matcher{};
+}
+
+using Pattern = Patterns::Pattern;
+using PatternVec = Patterns::PatternVec;
@@ -0,0 +1,217 @@
+#include "PlanCache.h"
+#include "FormData.h"
+
+namespace Distribute::PlanCache
+{
+	namespace
+	{
+		thread_local Session* activeSession{ nullptr };
+	}
+
+	Session::Session(Trace& a_recording) :
+		recording(&a_recording),
+		previous(std::exchange(activeSession, this))
+	{}
+
+	Session::Session(const Trace& a_replayed) :
+		replayed(&a_replayed),
+		previous(std::exchange(activeSession, this))
+	{}
+
+	Session::~Session()
+	{
+		activeSession = previous;
+	}
+
+	Session* Session::GetActive()
+	{
+		return activeSession;
+	}
+
+	void Session::Roll(std::uint64_t a_entry, bool a_passed)
+	{
+		step({ a_entry, true, a_passed });
+	}
+
+	std::optional<bool> Session::Replay(std::uint32_t a_programID) const
+	{
+		if (!replayed || diverged || cursor >= replayed->steps.size()) {
+			return std::nullopt;
+		}
+
+		const auto& next = replayed->steps[cursor];
+		if (next.roll || next.id != a_programID) {
+			return std::nullopt;
+		}
+
+		return next.passed;
+	}
+
+	void Session::Verdict(std::uint32_t a_programID, bool a_passed)
+	{
+		step({ a_programID, false, a_passed });
+	}
+
+	bool Session::HasDiverged() const
+	{
+		return diverged || (replayed && cursor != replayed->steps.size());
+	}
+
+	void Session::step(const Trace::Step& a_step)
+	{
+		if (recording) {
+			recording->steps.push_back(a_step);
+			return;
+		}
+
+		if (diverged) {
+			return;
+		}
+
+		// Once a single decision differs, NPC no longer matches the recorded one, so the rest of the Trace can't be trusted.
+		if (cursor < replayed->steps.size() && replayed->steps[cursor] == a_step) {
+			++cursor;
+		} else {
+			diverged = true;
+		}
+	}
+
+	std::optional<Key> Manager::GetKey(const NPCData& a_npcData, const PCLevelMult::Input& a_input)
+	{
+		const auto npc = a_npcData.GetNPC();
+		if (a_input.onlyPlayerLevelEntries || !npc->IsDynamicForm() || npc->IsUnique()) {
+			return std::nullopt;
+		}
+
+		// Buckets are built by the first NPC that is planned after entries were looked up, and dropped by Clear.
+		if (!levelsReady.load(std::memory_order_acquire)) {
+			WriteLocker locker(lock);
+			if (!levelsReady.load(std::memory_order_relaxed)) {
+				init_levels();
+				levelsReady.store(true, std::memory_order_release);
+			}
+		}
+
+		Key key{};
+
+		std::size_t i = 0;
+		a_npcData.ForEachID([&](RE::FormID a_formID) {
+			if (i < key.IDs.size()) {
+				key.IDs[i++] = a_formID;
+			}
+		});
+
+		if (const auto race = a_npcData.GetRace()) {
+			key.race = race->GetFormID();
+		}
+		if (const auto npcClass = npc->npcClass) {
+			key.npcClass = npcClass->GetFormID();
+		}
+		if (const auto location = a_npcData.GetActor()->GetEditorLocation()) {
+			key.location = location->GetFormID();
+		}
+
+		const auto level = a_npcData.GetLevel();
+		key.levelBucket = exactLevels ? level : get_level_bucket(level);
+		key.traits = a_npcData.GetFeatures().traits;
+
+		return key;
+	}
+
+	std::shared_ptr<const Trace> Manager::Find(const Key& a_key) const
+	{
+		ReadLocker locker(lock);
+
+		const auto it = traces.find(a_key);
+		return it != traces.end() ? it->second : nullptr;
+	}
+
+	void Manager::Insert(const Key& a_key, Trace&& a_trace)
+	{
+		WriteLocker locker(lock);
+
+		if (traces.size() < maxTraces) {
+			// When NPCs with the same key are planned in parallel, the first recorded Trace is kept.
+			traces.try_emplace(a_key, std::make_shared<const Trace>(std::move(a_trace)));
+		}
+	}
+
+	void Manager::CountHit(bool a_diverged)
+	{
+		(a_diverged ? partialHits : hits).fetch_add(1, std::memory_order_relaxed);
+		count_lookup();
+	}
+
+	void Manager::CountMiss()
+	{
+		misses.fetch_add(1, std::memory_order_relaxed);
+		count_lookup();
+	}
+
+	void Manager::LogStatistics() const
+	{
+		const auto fullHits = hits.load(std::memory_order_relaxed);
+		const auto partial = partialHits.load(std::memory_order_relaxed);
+		const auto total = fullHits + partial + misses.load(std::memory_order_relaxed);
+
+		std::size_t traceCount;
+		{
+			ReadLocker locker(lock);
+			traceCount = traces.size();
+		}
+
+		logger::info("Plan cache: {}/{} lookups replayed ({:.1f}%), {} of them diverged; {} NPC types cached", fullHits + partial, total, total ? 100.0 * static_cast<double>(fullHits + partial) / static_cast<double>(total) : 0.0, partial, traceCount);
+	}
+
+	void Manager::Clear()
+	{
+		{
+			WriteLocker locker(lock);
+			traces.clear();
+
+			levelBoundaries.clear();
+			exactLevels = false;
+			levelsReady.store(false, std::memory_order_release);
+		}
+
+		hits = 0;
+		partialHits = 0;
+		misses = 0;
+	}
+
+	void Manager::init_levels()
+	{
+		Forms::ForEachDistributable([&]<class Form>(Forms::Distributables<Form>& a_distributable) {
+			for (const auto& formData : a_distributable.GetForms()) {
+				const auto& [actorLevel, skillLevels, _] = formData.filters.levels;
+				if (actorLevel.IsValid()) {
+					levelBoundaries.push_back(actorLevel.min);
+					if (actorLevel.max < std::numeric_limits<std::uint16_t>::max()) {
+						levelBoundaries.push_back(static_cast<std::uint16_t>(actorLevel.max + 1));
+					}
+				}
+				if (!skillLevels.empty()) {
+					exactLevels = true;
+				}
+			}
+		});
+
+		std::ranges::sort(levelBoundaries);
+		const auto [first, last] = std::ranges::unique(levelBoundaries);
+		levelBoundaries.erase(first, last);
+	}
+
+	std::uint32_t Manager::get_level_bucket(std::uint16_t a_level) const
+	{
+		// Levels in the same bucket pass and fail exactly the same Actor Level filters.
+		return static_cast<std::uint32_t>(std::ranges::upper_bound(levelBoundaries, a_level) - levelBoundaries.begin());
+	}
+
+	void Manager::count_lookup()
+	{
+		const auto total = hits.load(std::memory_order_relaxed) + partialHits.load(std::memory_order_relaxed) + misses.load(std::memory_order_relaxed);
+		if (total % statisticsInterval == 0) {
+			LogStatistics();
+		}
+	}
+}
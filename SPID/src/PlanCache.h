@@ -0,0 +1,156 @@
+#pragma once
+
+#include "LookupNPC.h"
+#include "PCLevelMultManager.h"
+
+/// <summary>
+/// Cache of filter decisions for non-unique leveled actors.
+///
+/// Leveled lists spawn many actors whose bases are generated from the same templates.
+/// Such actors pass the same filters, so the decisions that planning took for the first of them
+/// are recorded as a Trace and replayed for the following ones instead of evaluating filter Programs again.
+/// Chance is still rolled for each actor, and as soon as an actor's rolls diverge from the Trace
+/// the rest of its plan is evaluated as usual. Items and leveled lists are always resolved per actor.
+/// </summary>
+namespace Distribute::PlanCache
+{
+	/// Decisions that filters took while planning distribution to an NPC, in order.
+	struct Trace
+	{
+		struct Step
+		{
+			std::uint64_t id{ 0 };  // Rolled entry (form and its index) for chance rolls, Program ID for verdicts.
+			bool          roll{ false };
+			bool          passed{ false };
+
+			bool operator==(const Step&) const = default;
+		};
+
+		std::vector<Step> steps{};
+	};
+
+	/// <summary>
+	/// Records decisions of filters into a Trace or replays a Trace that was recorded for an equal NPC.
+	///
+	/// Session becomes active on the current thread for its lifetime, so that filters that are checked during planning report to it.
+	/// While replaying, verdicts of Programs are provided by the Trace as long as every decision matches the recorded one.
+	/// </summary>
+	class Session
+	{
+	public:
+		/// Starts recording decisions into a_trace.
+		explicit Session(Trace& a_recording);
+
+		/// Starts replaying decisions that were recorded in a_trace.
+		explicit Session(const Trace& a_replayed);
+
+		~Session();
+
+		Session(const Session&) = delete;
+		Session& operator=(const Session&) = delete;
+
+		/// Session that is active on the current thread, if any.
+		[[nodiscard]] static Session* GetActive();
+
+		/// Reports a chance roll of the entry identified by a_entry.
+		void Roll(std::uint64_t a_entry, bool a_passed);
+
+		/// Verdict of the Program that the replayed Trace has for the next decision, if it is still followed.
+		[[nodiscard]] std::optional<bool> Replay(std::uint32_t a_programID) const;
+
+		/// Reports a verdict of the Program, whether it was memoized, evaluated or replayed.
+		void Verdict(std::uint32_t a_programID, bool a_passed);
+
+		/// Whether decisions stopped following the replayed Trace, or didn't reach its end.
+		[[nodiscard]] bool HasDiverged() const;
+
+	private:
+		void step(const Trace::Step& a_step);
+
+		Trace*       recording{ nullptr };
+		const Trace* replayed{ nullptr };
+		std::size_t  cursor{ 0 };
+		bool         diverged{ false };
+		Session*     previous{ nullptr };
+	};
+
+	/// <summary>
+	/// Features of an NPC that filters of all entries can't tell apart.
+	///
+	/// Actor level is reduced to the interval between levels that Level Filters of entries compare with.
+	/// </summary>
+	struct Key
+	{
+		std::array<RE::FormID, 3> IDs{};  // Templates that identify NPC, see NPCData::ForEachID.
+		RE::FormID                race{ 0 };
+		RE::FormID                npcClass{ 0 };
+		RE::FormID                location{ 0 };  // Editor location of the actor, which Location filters are checked against.
+		std::uint32_t             levelBucket{ 0 };
+		std::uint32_t             traits{ 0 };
+
+		bool operator==(const Key&) const = default;
+
+		struct hash
+		{
+			using is_avalanching = void;  // mark class as high quality avalanching hash
+
+			[[nodiscard]] std::uint64_t operator()(const Key& a_key) const noexcept
+			{
+				static_assert(std::has_unique_object_representations_v<Key>);  // Keys are hashed as plain bytes.
+				return ankerl::unordered_dense::detail::wyhash::hash(&a_key, sizeof(Key));
+			}
+		};
+	};
+
+	class Manager : public ISingleton<Manager>
+	{
+	public:
+		/// Maximum number of Traces that are kept. Once it's reached new NPCs are planned without the cache.
+		static constexpr std::size_t maxTraces = 4096;
+
+		/// Number of lookups after which statistics are logged again.
+		static constexpr std::uint64_t statisticsInterval = 256;
+
+		/// <summary>
+		/// Returns a key of the NPC if its plans can be cached.
+		///
+		/// Only non-unique actors with generated (leveled) bases are cached, and only for the full distribution.
+		/// </summary>
+		[[nodiscard]] std::optional<Key> GetKey(const NPCData& a_npcData, const PCLevelMult::Input& a_input);
+
+		[[nodiscard]] std::shared_ptr<const Trace> Find(const Key& a_key) const;
+		void                                       Insert(const Key& a_key, Trace&& a_trace);
+
+		/// Counts a lookup that found a Trace. a_diverged tells whether the Trace was followed only partially.
+		void CountHit(bool a_diverged);
+		void CountMiss();
+
+		void LogStatistics() const;
+
+		/// <summary>
+		/// Forgets all Traces, statistics and level buckets.
+		///
+		/// Must be called whenever entries change, while no NPCs are being planned.
+		/// </summary>
+		void Clear();
+
+	private:
+		/// Computes boundaries of level buckets from Level Filters of all entries.
+		void init_levels();
+
+		[[nodiscard]] std::uint32_t get_level_bucket(std::uint16_t a_level) const;
+
+		void count_lookup();
+
+		mutable Lock                                                               lock;
+		ankerl::unordered_dense::map<Key, std::shared_ptr<const Trace>, Key::hash> traces{};
+
+		std::atomic<bool>          levelsReady{ false };
+		std::vector<std::uint16_t> levelBoundaries{};  // Sorted levels at which some Level Filter starts or stops passing.
+		bool                       exactLevels{ false };  // Skill Level filters depend on actor level in ways that can't be bucketed.
+
+		std::atomic<std::uint64_t> hits{ 0 };
+		std::atomic<std::uint64_t> partialHits{ 0 };
+		std::atomic<std::uint64_t> misses{ 0 };
+	};
+}
@@ -0,0 +1,44 @@
+#include "Random.h"
+
+namespace Random
+{
+	namespace
+	{
+		enum class Roll : std::uint64_t
+		{
+			kChance = 0,
+			kCount = 1
+		};
+
+		std::atomic<Seed> seed{ [] {
+			std::random_device device{};
+			return (static_cast<Seed>(device()) << 32) | device();
+		}() };
+
+		std::uint64_t make_key(RE::FormID a_form, Roll a_roll)
+		{
+			return detail::make_key(seed.load(std::memory_order_relaxed) ^ (static_cast<std::uint64_t>(a_form) << 1 | std::to_underlying(a_roll)));
+		}
+	}
+
+	void SetSeed(Seed a_seed)
+	{
+		seed.store(a_seed, std::memory_order_relaxed);
+	}
+
+	Seed GetSeed()
+	{
+		return seed.load(std::memory_order_relaxed);
+	}
+
+	Stream::Stream(RE::FormID a_actor, RE::FormID a_form, std::uint32_t a_entry) :
+		counter((static_cast<std::uint64_t>(a_actor) << 32) | a_entry),
+		chanceKey(make_key(a_form, Roll::kChance)),
+		countKey(make_key(a_form, Roll::kCount))
+	{}
+
+	double Stream::Chance() const
+	{
+		return detail::squares32(counter, chanceKey) * 0x1p-32;
+	}
+}
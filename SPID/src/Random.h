@@ -0,0 +1,78 @@
+#pragma once
+
+/// Random provides a counter-based generator for chance and count rolls.
+///
+/// Each roll is a pure function of the session seed and of what is being rolled (actor, distributed form and its entry),
+/// so rolls don't share any state, can be made from any thread in any order,
+/// and two runs with the same seed make exactly the same rolls.
+///	<p>
+///	The generator is Squares (Widynski, 2020): four rounds of squaring a 64-bit counter that is offset by a key.
+///	</p>
+namespace Random
+{
+	using Seed = std::uint64_t;
+
+	/// Sets the seed that all rolls are derived from.
+	///	By default it is picked randomly once per session.
+	void SetSeed(Seed a_seed);
+
+	[[nodiscard]] Seed GetSeed();
+
+	namespace detail
+	{
+		/// Squares generator: returns a random value for the counter in the stream identified by the key.
+		[[nodiscard]] constexpr std::uint32_t squares32(std::uint64_t a_counter, std::uint64_t a_key)
+		{
+			std::uint64_t y = a_counter * a_key;
+			std::uint64_t z = y + a_key;
+			std::uint64_t x = y;
+
+			x = x * x + y;
+			x = (x >> 32) | (x << 32);
+			x = x * x + z;
+			x = (x >> 32) | (x << 32);
+			x = x * x + y;
+			x = (x >> 32) | (x << 32);
+			return static_cast<std::uint32_t>((x * x + z) >> 32);
+		}
+
+		/// Turns arbitrary value into a well-mixed key with odd low bits, as Squares expects.
+		[[nodiscard]] constexpr std::uint64_t make_key(std::uint64_t a_value)
+		{
+			// SplitMix64 finalizer.
+			a_value += 0x9E3779B97F4A7C15ull;
+			a_value = (a_value ^ (a_value >> 30)) * 0xBF58476D1CE4E5B9ull;
+			a_value = (a_value ^ (a_value >> 27)) * 0x94D049BB133111EBull;
+			return (a_value ^ (a_value >> 31)) | 1;
+		}
+	}
+
+	/// <summary>
+	/// Rolls that are made for a single entry of a distributed form when it is considered for an actor.
+	///
+	/// Stream itself is stateless: each kind of roll always returns the same value for the same actor, form, entry and seed.
+	/// </summary>
+	class Stream
+	{
+	public:
+		Stream(RE::FormID a_actor, RE::FormID a_form, std::uint32_t a_entry);
+
+		/// Returns a random value in [0, 1) that is compared against entry's chance.
+		[[nodiscard]] double Chance() const;
+
+		/// Returns a random count in [a_min, a_max].
+		template <std::integral T>
+		[[nodiscard]] T Count(T a_min, T a_max) const
+		{
+			const auto span = static_cast<std::uint64_t>(static_cast<std::int64_t>(a_max) - static_cast<std::int64_t>(a_min)) + 1;
+			// Multiply-shift maps 32 random bits onto the range without division.
+			const auto offset = (static_cast<std::uint64_t>(detail::squares32(counter, countKey)) * span) >> 32;
+			return static_cast<T>(static_cast<std::int64_t>(a_min) + static_cast<std::int64_t>(offset));
+		}
+
+	private:
+		std::uint64_t counter;
+		std::uint64_t chanceKey;
+		std::uint64_t countKey;
+	};
+}
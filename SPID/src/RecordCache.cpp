@@ -0,0 +1,56 @@
+#include "RecordCache.h"
+
+namespace NPC::Records
+{
+	template <class Key, class Value, class Factory>
+	const Value& Cache::get(Map<const Key*, std::unique_ptr<const Value>>& a_map, const Key* a_key, Factory&& a_factory)
+	{
+		{
+			ReadLocker locker(lock);
+			if (const auto it = a_map.find(a_key); it != a_map.end()) {
+				return *it->second;
+			}
+		}
+
+		// Value is created outside of the lock. If another thread created it in the meantime, the first one wins.
+		auto value = std::make_unique<const Value>(a_factory());
+
+		WriteLocker locker(lock);
+		return *a_map.try_emplace(a_key, std::move(value)).first->second;
+	}
+
+	const Race& Cache::GetRace(RE::TESRace* a_race)
+	{
+		return get(races, a_race, [&] {
+			Race race{};
+
+			a_race->ForEachKeyword([&](const RE::BGSKeyword* a_keyword) {
+				race.keywords.emplace(CaseFold::folded(a_keyword->GetFormEditorID()));
+				if (const auto atom = Atoms::Find(a_keyword)) {
+					race.strings.atoms.insert(*atom);
+				}
+				Patterns::matcher.Match(a_keyword, race.strings.patterns);
+				return RE::BSContainer::ForEachResult::kContinue;
+			});
+
+			race.child = a_race->formEditorID.contains("RaceChild");
+
+			return race;
+		});
+	}
+
+	const Strings& Cache::GetTemplate(const RE::TESForm* a_base)
+	{
+		return get(templates, a_base, [&] {
+			Strings strings{};
+
+			const auto editorID = editorID::get_editorID(a_base);
+			if (const auto atom = Atoms::Find(editorID)) {
+				strings.atoms.insert(*atom);
+			}
+			Patterns::matcher.Match(editorID, strings.patterns);
+
+			return strings;
+		});
+	}
+}
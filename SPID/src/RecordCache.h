@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Atoms.h"
+#include "Patterns.h"
+
+/// Parts of NPC Data that only depend on records shared by many actors (races and base/template NPCs).
+///
+/// These records don't change after the game has loaded, so their strings are collected once
+/// and every actor that uses the same race or template reuses them.
+namespace NPC::Records
+{
+	/// Atoms and Patterns of strings that belong to a record.
+	struct Strings
+	{
+		Atoms::Set    atoms{};
+		Patterns::Set patterns{};
+	};
+
+	struct Race
+	{
+		StringSet keywords{};  // Folded EditorIDs of race's keywords.
+		Strings   strings{};   // Strings of race's keywords.
+		bool      child{ false };
+	};
+
+	/// <summary>
+	/// Caches shared parts of NPC Data.
+	///
+	/// Entries are never removed, so references returned by the cache stay valid.
+	/// NPCs are processed on multiple threads, so access is synchronized.
+	/// </summary>
+	class Cache : public ISingleton<Cache>
+	{
+	public:
+		const Race& GetRace(RE::TESRace* a_race);
+
+		/// Returns strings of EditorID of the base NPC or template record.
+		const Strings& GetTemplate(const RE::TESForm* a_base);
+
+	private:
+		template <class Key, class Value, class Factory>
+		const Value& get(Map<const Key*, std::unique_ptr<const Value>>& a_map, const Key* a_key, Factory&& a_factory);
+
+		Lock                                                    lock;
+		Map<const RE::TESRace*, std::unique_ptr<const Race>>    races{};
+		Map<const RE::TESForm*, std::unique_ptr<const Strings>> templates{};
+	};
+}
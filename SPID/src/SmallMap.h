@@ -0,0 +1,74 @@
+#pragma once
+
+#include "SmallVector.h"
+
+/// <summary>
+/// A map that keeps its entries sorted by key in a SmallVector.
+///
+/// Up to N entries are stored inline, so collecting a few values for an NPC doesn't allocate,
+/// while iteration order is the same as the one of std::map with the same keys.
+/// </summary>
+template <class Key, class Value, std::size_t N>
+class SmallMap
+{
+public:
+	struct value_type
+	{
+		Key   first;
+		Value second;
+	};
+
+	using iterator = value_type*;
+	using const_iterator = const value_type*;
+
+	[[nodiscard]] std::size_t size() const { return entries.size(); }
+	[[nodiscard]] bool        empty() const { return entries.empty(); }
+
+	/// Whether entries are still stored inline.
+	[[nodiscard]] bool IsInline() const { return entries.IsInline(); }
+
+	[[nodiscard]] iterator       begin() { return entries.begin(); }
+	[[nodiscard]] iterator       end() { return entries.end(); }
+	[[nodiscard]] const_iterator begin() const { return entries.begin(); }
+	[[nodiscard]] const_iterator end() const { return entries.end(); }
+
+	/// Returns value of the key, inserting a value-initialized one if the key is missing.
+	Value& operator[](const Key& a_key)
+	{
+		auto it = lower_bound(a_key);
+		if (it == end() || it->first != a_key) {
+			it = entries.insert(it, { a_key, Value{} });
+		}
+		return it->second;
+	}
+
+	[[nodiscard]] iterator find(const Key& a_key)
+	{
+		const auto it = lower_bound(a_key);
+		return it != end() && it->first == a_key ? it : end();
+	}
+
+	[[nodiscard]] const_iterator find(const Key& a_key) const
+	{
+		return const_cast<SmallMap*>(this)->find(a_key);
+	}
+
+	iterator erase(const_iterator a_pos)
+	{
+		return entries.erase(a_pos);
+	}
+
+	/// Removes all entries. Memory that was allocated on the heap is kept for reuse.
+	void clear()
+	{
+		entries.clear();
+	}
+
+private:
+	SmallVector<value_type, N> entries{};
+
+	iterator lower_bound(const Key& a_key)
+	{
+		return std::lower_bound(begin(), end(), a_key, [](const value_type& a_entry, const Key& a_key) { return a_entry.first < a_key; });
+	}
+};
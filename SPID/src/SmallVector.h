@@ -0,0 +1,94 @@
+#pragma once
+
+/// <summary>
+/// A vector that keeps up to N elements inline and moves them to the heap only when it grows beyond that.
+///
+/// It is meant for short-lived per-NPC containers, which are small in the vast majority of cases,
+/// so that typical NPCs are processed without any heap allocations.
+/// Only trivially copyable elements are supported, which keeps moving elements between storages a plain copy.
+/// </summary>
+template <class T, std::size_t N>
+	requires std::is_trivially_copyable_v<T>
+class SmallVector
+{
+public:
+	using value_type = T;
+	using iterator = T*;
+	using const_iterator = const T*;
+
+	[[nodiscard]] T*       data() { return onHeap ? heap.data() : local.data(); }
+	[[nodiscard]] const T* data() const { return onHeap ? heap.data() : local.data(); }
+
+	[[nodiscard]] std::size_t size() const { return onHeap ? heap.size() : count; }
+	[[nodiscard]] bool        empty() const { return size() == 0; }
+
+	/// Whether elements are still stored inline.
+	[[nodiscard]] bool IsInline() const { return !onHeap; }
+
+	[[nodiscard]] iterator       begin() { return data(); }
+	[[nodiscard]] iterator       end() { return data() + size(); }
+	[[nodiscard]] const_iterator begin() const { return data(); }
+	[[nodiscard]] const_iterator end() const { return data() + size(); }
+
+	[[nodiscard]] T&       operator[](std::size_t a_index) { return data()[a_index]; }
+	[[nodiscard]] const T& operator[](std::size_t a_index) const { return data()[a_index]; }
+
+	/// Removes all elements. Memory that was allocated on the heap is kept for reuse.
+	void clear()
+	{
+		count = 0;
+		heap.clear();
+	}
+
+	void push_back(const T& a_value)
+	{
+		insert(end(), a_value);
+	}
+
+	iterator insert(const_iterator a_pos, const T& a_value)
+	{
+		const auto index = static_cast<std::size_t>(a_pos - begin());
+
+		if (!onHeap && count == N) {
+			spill();
+		}
+
+		if (onHeap) {
+			heap.insert(heap.begin() + index, a_value);
+			return heap.data() + index;
+		}
+
+		std::copy_backward(local.begin() + index, local.begin() + count, local.begin() + count + 1);
+		local[index] = a_value;
+		++count;
+		return local.data() + index;
+	}
+
+	iterator erase(const_iterator a_pos)
+	{
+		const auto index = static_cast<std::size_t>(a_pos - begin());
+
+		if (onHeap) {
+			heap.erase(heap.begin() + index);
+			return heap.data() + index;
+		}
+
+		std::copy(local.begin() + index + 1, local.begin() + count, local.begin() + index);
+		--count;
+		return local.data() + index;
+	}
+
+private:
+	std::array<T, N> local{};
+	std::vector<T>   heap{};
+	std::size_t      count{ 0 };  // Number of inline elements.
+	bool             onHeap{ false };
+
+	void spill()
+	{
+		heap.reserve(N * 2);
+		heap.assign(local.begin(), local.begin() + count);
+		count = 0;
+		onHeap = true;
+	}
+};
@@ -0,0 +1,37 @@
+#ifndef NDEBUG
+#	include "Testing.h"
+
+// Global operator new and delete are replaced only in builds that run tests (see main.cpp), and only here, so the plugin has a single definition of them.
+// Array and nothrow forms of operator new fall back to this one, so they are counted too.
+// Each allocation is prefixed with its size, so that freed bytes can be subtracted.
+// The prefix takes the whole default alignment of new (16 bytes on x64, while max_align_t is only 8 on MSVC),
+// so that types like SkillRanges that are loaded with aligned SSE loads stay aligned.
+constexpr std::size_t allocationHeader = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+static_assert(allocationHeader >= sizeof(std::size_t) && allocationHeader >= alignof(std::max_align_t));
+
+void* operator new(std::size_t a_size)
+{
+	++::Testing::Allocations::count;
+	if (const auto ptr = static_cast<std::byte*>(std::malloc(allocationHeader + a_size))) {
+		*reinterpret_cast<std::size_t*>(ptr) = a_size;
+		::Testing::Allocations::bytes += static_cast<std::ptrdiff_t>(a_size);
+		assert(reinterpret_cast<std::uintptr_t>(ptr + allocationHeader) % __STDCPP_DEFAULT_NEW_ALIGNMENT__ == 0);
+		return ptr + allocationHeader;
+	}
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* a_ptr) noexcept
+{
+	if (a_ptr) {
+		const auto ptr = static_cast<std::byte*>(a_ptr) - allocationHeader;
+		::Testing::Allocations::bytes -= static_cast<std::ptrdiff_t>(*reinterpret_cast<std::size_t*>(ptr));
+		std::free(ptr);
+	}
+}
+
+void operator delete(void* a_ptr, std::size_t) noexcept
+{
+	operator delete(a_ptr);
+}
+#endif
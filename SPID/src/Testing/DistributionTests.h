@@ -1,6 +1,10 @@
 #pragma once
+#include "Distribute.h"
+#include "DistributeBatch.h"
 #include "DistributeManager.h"
 #include "FormData.h"
+#include "LinkedDistribution.h"
+#include "Outfits/OutfitManager.h"
 #include "Testing.h"
 #include "TestsHelpers.h"
 
@@ -47,5 +51,700 @@ namespace Distribute
 			auto got = ::Testing::Helper::Inventory::GetItemCount(actor, item);
 			EXPECT(got == 1, fmt::format("Expected actor to have 1 item, but they have {}", got));
 		}
+
+		TEST(PlanIsNotAppliedUntilCommitted)
+		{
+			auto        actor{ ::Testing::Helper::Actor::GetActor() };
+			auto        item{ ::Testing::Helper::Data::GetItem() };
+			FilterData  filterData{ {}, {}, {}, {}, 100 };
+			RandomCount idxOrCount{ 1, 1 };
+
+			::Testing::Helper::Distribution::GetItems().EmplaceForm(true, item, false, idxOrCount, filterData, Path{ "" });
+
+			NPCData                  npcData{ actor, actor->GetActorBase() };
+			const PCLevelMult::Input input{ actor, actor->GetActorBase(), false };
+
+			Forms::DistributionSet entries{
+				Forms::DistributionSet::empty<RE::SpellItem>(),
+				Forms::DistributionSet::empty<RE::BGSPerk>(),
+				::Testing::Helper::Distribution::GetItems().GetForms(false),
+				Forms::DistributionSet::empty<RE::TESShout>(),
+				Forms::DistributionSet::empty<RE::TESLevSpell>(),
+				Forms::DistributionSet::empty<RE::TESForm>(),
+				Forms::DistributionSet::empty<RE::BGSOutfit>(),
+				Forms::DistributionSet::empty<RE::BGSKeyword>(),
+				Forms::DistributionSet::empty<RE::TESFaction>(),
+				Forms::DistributionSet::empty<RE::BGSOutfit>(),
+				Forms::DistributionSet::empty<RE::TESObjectARMO>()
+			};
+
+			DistributionPlan plan{};
+			Plan(npcData, input, entries, plan);
+
+			const auto& entry = ::Testing::Helper::Distribution::GetItems().GetForms(false).front();
+
+			const auto planned = ::Testing::Helper::Inventory::GetItemCount(actor, item);
+			ASSERT(plan.items.find(item) != plan.items.end(), "Expected item to be planned");
+			ASSERT(planned == 0, fmt::format("Expected planning not to give items, but actor has {}", planned));
+			ASSERT(entry.npcCount == 0, fmt::format("Expected planning not to count NPCs of the entry, but it counted {}", entry.npcCount));
+
+			Apply(npcData, input, plan, ::Outfits::SetDefaultOutfit);
+
+			const auto applied = ::Testing::Helper::Inventory::GetItemCount(actor, item);
+			ASSERT(applied == 1, fmt::format("Expected actor to have 1 item once plan is applied, but they have {}", applied));
+			EXPECT(entry.npcCount == 1, fmt::format("Expected the entry to count 1 NPC once plan is applied, but it counted {}", entry.npcCount));
+		}
+
+		TEST(LeveledListsAreResolvedAfterPlanning)
+		{
+			auto        actor{ ::Testing::Helper::Actor::GetActor() };
+			auto        leveledItem{ ::Testing::Helper::Data::GetLeveledItem() };
+			FilterData  filterData{ {}, {}, {}, {}, 100 };
+			RandomCount idxOrCount{ 1, 1 };
+
+			::Testing::Helper::Distribution::GetItems().EmplaceForm(true, leveledItem, false, idxOrCount, filterData, Path{ "" });
+
+			NPCData                  npcData{ actor, actor->GetActorBase() };
+			const PCLevelMult::Input input{ actor, actor->GetActorBase(), false };
+
+			Forms::DistributionSet entries{
+				Forms::DistributionSet::empty<RE::SpellItem>(),
+				Forms::DistributionSet::empty<RE::BGSPerk>(),
+				::Testing::Helper::Distribution::GetItems().GetForms(false),
+				Forms::DistributionSet::empty<RE::TESShout>(),
+				Forms::DistributionSet::empty<RE::TESLevSpell>(),
+				Forms::DistributionSet::empty<RE::TESForm>(),
+				Forms::DistributionSet::empty<RE::BGSOutfit>(),
+				Forms::DistributionSet::empty<RE::BGSKeyword>(),
+				Forms::DistributionSet::empty<RE::TESFaction>(),
+				Forms::DistributionSet::empty<RE::BGSOutfit>(),
+				Forms::DistributionSet::empty<RE::TESObjectARMO>()
+			};
+
+			// Planning can run on worker threads, so it must not call into the game to resolve leveled lists.
+			DistributionPlan plan{};
+			Plan(npcData, input, entries, plan);
+
+			ASSERT(plan.leveledItems.size() == 1 && plan.leveledItems[0].list == leveledItem, "Expected leveled list to be planned unresolved");
+			ASSERT(plan.items.empty(), "Expected no items to be planned before the leveled list is resolved");
+
+			ResolveLeveledItems(npcData, input, plan, LinkedDistribution::kRegular);
+
+			EXPECT(plan.leveledItems.empty(), "Expected leveled list to be resolved on the main thread");
+		}
+
+		TEST(CandidatesIncludeEntriesThatNeedPlannedFactions)
+		{
+			const auto actor = ::Testing::Helper::Actor::GetActor();
+			NPCData    npcData{ actor, actor->GetActorBase() };
+
+			const PCLevelMult::Input input{ actor, actor->GetActorBase(), false };
+
+			const auto dataHandler = RE::TESDataHandler::GetSingleton();
+
+			RE::TESFaction* faction = nullptr;
+			for (const auto candidate : dataHandler->GetFormArray<RE::TESFaction>()) {
+				if (candidate && !npcData.HasMember(candidate)) {
+					faction = candidate;
+					break;
+				}
+			}
+			RE::SpellItem* spell = nullptr;
+			for (const auto candidate : dataHandler->GetFormArray<RE::SpellItem>()) {
+				if (candidate && !npcData.HasMember(candidate)) {
+					spell = candidate;
+					break;
+				}
+			}
+			ASSERT(faction && spell, "Expected a faction and a spell that NPC doesn't have");
+
+			// The spell's entry is posted under the faction in the candidate index, and NPC only receives the faction in the same plan.
+			FormFilters requiredFaction{};
+			requiredFaction.ALL.push_back(faction);
+			::Testing::Helper::Distribution::GetFactions().EmplaceForm(true, faction, false, RandomCount(1, 1), FilterData{ {}, {}, {}, {}, 100 }, Path{ "" });
+			::Testing::Helper::Distribution::GetSpells().EmplaceForm(true, spell, false, RandomCount(1, 1), FilterData{ {}, requiredFaction, {}, {}, 100 }, Path{ "" });
+
+			::Testing::Helper::Distribution::GetFactions().FinishLookupForms();
+			::Testing::Helper::Distribution::GetSpells().FinishLookupForms();
+
+			auto& spells = ::Testing::Helper::Distribution::GetSpells().GetForms(false);
+			ASSERT(spells.candidates.IsValid(spells.size()), "Expected candidate index of spells to be built");
+
+			Forms::DistributionSet entries{
+				spells,
+				Forms::DistributionSet::empty<RE::BGSPerk>(),
+				Forms::DistributionSet::empty<RE::TESBoundObject>(),
+				Forms::DistributionSet::empty<RE::TESShout>(),
+				Forms::DistributionSet::empty<RE::TESLevSpell>(),
+				Forms::DistributionSet::empty<RE::TESForm>(),
+				Forms::DistributionSet::empty<RE::BGSOutfit>(),
+				Forms::DistributionSet::empty<RE::BGSKeyword>(),
+				::Testing::Helper::Distribution::GetFactions().GetForms(false),
+				Forms::DistributionSet::empty<RE::BGSOutfit>(),
+				Forms::DistributionSet::empty<RE::TESObjectARMO>()
+			};
+
+			DistributionPlan plan{};
+			Plan(npcData, input, entries, plan);
+
+			::Testing::Helper::Distribution::ClearConfigs();
+			::Testing::Helper::Distribution::GetFactions().FinishLookupForms();
+			::Testing::Helper::Distribution::GetSpells().FinishLookupForms();
+
+			ASSERT(std::ranges::find(plan.factions, faction) != plan.factions.end(), "Expected the faction to be planned");
+			EXPECT(std::ranges::find(plan.spells, spell) != plan.spells.end(), "Expected the spell entry that requires the planned faction to be a candidate");
+		}
+
+		TEST(Batch_PlansAsSerialDistribution)
+		{
+			constexpr std::uint32_t entryCount = 200;
+
+			const auto spells = RE::TESDataHandler::GetSingleton()->GetFormArray<RE::SpellItem>();
+			ASSERT(spells.size() >= entryCount, "Expected enough spells to distribute");
+
+			// Chance makes plans differ between NPCs, and since rolls are keyed by actors they don't depend on the order of planning.
+			for (std::uint32_t i = 0; i < entryCount; ++i) {
+				::Testing::Helper::Distribution::GetSpells().EmplaceForm(true, spells[i], false, RandomCount{ 1, 1 }, FilterData{ {}, {}, {}, {}, 50 }, Path{ "" });
+			}
+
+			auto            actors = ::Testing::Helper::Actor::GetLoaded();
+			Set<RE::FormID> npcIDs{};
+			std::erase_if(actors, [&](RE::Actor* a_actor) { return !npcIDs.insert(a_actor->GetActorBase()->GetFormID()).second; });
+			ASSERT(!actors.empty(), "Expected at least one loaded NPC");
+
+			const auto make_npcs = [&] {
+				std::vector<NPCData> npcs{};
+				for (const auto actor : actors) {
+					npcs.emplace_back(actor);
+				}
+				return npcs;
+			};
+
+			auto serialNPCs = make_npcs();
+			auto batchNPCs = make_npcs();
+
+			std::vector<DistributionPlan> serialPlans(serialNPCs.size());
+			const auto                    serialTime = ::Testing::Benchmark::Measure([&] {
+				for (std::size_t i = 0; i < serialNPCs.size(); ++i) {
+					const PCLevelMult::Input input{ serialNPCs[i].GetActor(), serialNPCs[i].GetNPC(), false };
+					Plan(serialNPCs[i], input, serialPlans[i]);
+				}
+			});
+
+			std::vector<DistributionPlan> batchPlans{};
+			const auto                    batchTime = ::Testing::Benchmark::Measure([&] { batchPlans = Batch::Plan(batchNPCs); });
+
+			::Testing::Benchmark::Report("Planning {} NPCs: {}μs serially, {}μs in a batch", actors.size(), serialTime, batchTime);
+
+			for (std::size_t i = 0; i < actors.size(); ++i) {
+				const auto& serial = serialPlans[i].distributedForms;
+				const auto& batch = batchPlans[i].distributedForms;
+				ASSERT(std::equal(serial.begin(), serial.end(), batch.begin(), batch.end()), fmt::format("Expected batch plan of {} to be the same as the serial one", *actors[i]));
+			}
+			PASS;
+		}
+
+		TEST(PlanCache_ReplayMatchesEvaluation)
+		{
+			constexpr std::uint32_t entryCount = 2000;
+
+			const auto& spells = RE::TESDataHandler::GetSingleton()->GetFormArray<RE::SpellItem>();
+			ASSERT(spells.size() >= entryCount, "Expected enough spells to distribute");
+
+			// Traces are shared by NPCs that entries can't tell apart, and entries below filter only by sex.
+			std::vector<RE::Actor*> actors{};
+			for (const auto actor : ::Testing::Helper::Actor::GetLoaded()) {
+				if (actors.size() < 2 && (actors.empty() || actors[0]->GetActorBase()->GetSex() == actor->GetActorBase()->GetSex())) {
+					actors.push_back(actor);
+				}
+			}
+			ASSERT(actors.size() == 2, "Expected at least two loaded NPCs of the same sex");
+
+			// Chance makes rolls of the two NPCs differ, and traits give Programs something to evaluate.
+			std::mt19937                    rng{ ::Testing::Helper::seed };
+			std::uniform_int_distribution<> sex{ 0, 2 };
+
+			Forms::DataVec<RE::SpellItem> entries{};
+			for (std::uint32_t i = 0; i < entryCount; ++i) {
+				Traits traits{};
+				if (const auto value = sex(rng); value < 2) {
+					traits.sex = static_cast<RE::SEX>(value);
+				}
+				entries.emplace_back(i, false, spells[i], RandomCount(1, 1), FilterData{ {}, {}, {}, traits, i % 2 ? 50 : 100 }, Paths::none);
+			}
+
+			const auto plan = [&](RE::Actor* a_actor) {
+				NPCData                     npcData{ a_actor };
+				const PCLevelMult::Input    input{ a_actor, npcData.GetNPC(), false };
+				std::vector<RE::SpellItem*> planned{};
+				for_each_form<RE::SpellItem>(npcData, entries, input, [&](const std::vector<RE::SpellItem*>& a_spells) { planned = a_spells; });
+				return planned;
+			};
+
+			PlanCache::Trace            trace{};
+			std::vector<RE::SpellItem*> recorded{};
+			const auto                  recordTime = ::Testing::Benchmark::Measure([&] {
+				PlanCache::Session session{ trace };
+				recorded = plan(actors[0]);
+			});
+
+			std::vector<RE::SpellItem*> replayed{};
+			bool                        diverged = false;
+			const auto                  replayTime = ::Testing::Benchmark::Measure([&] {
+				PlanCache::Session session{ std::as_const(trace) };
+				replayed = plan(actors[0]);
+				diverged = session.HasDiverged();
+			});
+
+			::Testing::Benchmark::Report("Planning {} entries: {}μs evaluated, {}μs replayed ({} decisions)", entryCount, recordTime, replayTime, trace.steps.size());
+
+			ASSERT(!trace.steps.empty(), "Expected decisions to be recorded");
+			ASSERT(!diverged, "Expected replay for the same NPC to follow the whole trace");
+			ASSERT(replayed == recorded, "Expected replayed plan to be the same as the evaluated one");
+
+			// Another NPC rolls differently, so it leaves the trace and the rest of its plan is evaluated.
+			std::vector<RE::SpellItem*> other{};
+			{
+				PlanCache::Session session{ std::as_const(trace) };
+				other = plan(actors[1]);
+			}
+			EXPECT(other == plan(actors[1]), fmt::format("Expected plan of {} that diverged from the trace to be the same as the evaluated one", *actors[1]));
+		}
+
+		TEST(DistributedForms_StayInlineForTypicalNPCs)
+		{
+			const auto spells = RE::TESDataHandler::GetSingleton()->GetFormArray<RE::SpellItem>();
+			ASSERT(spells.size() > Forms::DistributedForms::inlineCapacity, "Expected enough spells to fill distributed forms");
+
+			const auto path = Paths::Intern("Test_DISTR.ini");
+
+			Forms::DistributedForms forms{};
+			// Insert in reverse order, so that the set has to keep them sorted.
+			for (auto i = Forms::DistributedForms::inlineCapacity; i > 0; --i) {
+				ASSERT(forms.insert({ spells[i - 1], path }), "Expected new form to be inserted");
+			}
+			ASSERT(forms.IsInline(), "Expected forms to stay inline up to inline capacity");
+			ASSERT(!forms.insert({ spells[0], path }), "Expected duplicate form to be skipped");
+			ASSERT(forms.insert({ spells[0], Paths::none }), "Expected form from another config to be inserted");
+			ASSERT(forms.size() == Forms::DistributedForms::inlineCapacity + 1, fmt::format("Expected {} forms, but got {}", Forms::DistributedForms::inlineCapacity + 1, forms.size()));
+			ASSERT(!forms.IsInline(), "Expected forms to spill to the heap once inline capacity is exceeded");
+			ASSERT(std::is_sorted(forms.begin(), forms.end()), "Expected forms to be sorted");
+			ASSERT(std::adjacent_find(forms.begin(), forms.end()) == forms.end(), "Expected forms to be unique");
+			ASSERT(Paths::Get(path) == "Test_DISTR.ini", "Expected interned path to be resolved");
+			EXPECT(Paths::Intern("Test_DISTR.ini") == path, "Expected the same path to be interned once");
+		}
+
+		TEST(ItemCounts_CollectWithoutAllocations)
+		{
+			constexpr std::size_t   rounds = 1000;
+			constexpr std::uint32_t itemCount = 8;
+
+			const auto  dataHandler = RE::TESDataHandler::GetSingleton();
+			const auto& items = dataHandler->GetFormArray<RE::TESObjectMISC>();
+			const auto& leveledItems = dataHandler->GetFormArray<RE::TESLevItem>();
+			ASSERT(items.size() >= itemCount && !leveledItems.empty(), "Expected enough items and leveled lists");
+
+			// A handful of items and a leveled list, as configs typically give to an NPC.
+			Forms::DataVec<RE::TESBoundObject> entries{};
+			for (std::uint32_t i = 0; i < itemCount; ++i) {
+				entries.emplace_back(i, false, items[i], RandomCount(1, 3), FilterData{ {}, {}, {}, {}, 100 }, Paths::none);
+			}
+			entries.emplace_back(itemCount, false, leveledItems[0], RandomCount(1, 1), FilterData{ {}, {}, {}, {}, 100 }, Paths::none);
+
+			// Lists of configured entries always have their candidate index built, so collection goes through it as well.
+			entries.candidates.Build(entries);
+			ASSERT(entries.candidates.IsValid(entries.size()), "Expected candidate index of entries to be built");
+
+			const NPCData            npcData{ ::Testing::Helper::Actor::GetActor() };
+			const PCLevelMult::Input input{ npcData.GetActor(), npcData.GetNPC(), false };
+
+			std::size_t collected = 0;
+			bool        inlined = true;
+
+			const auto collect = [&](ItemCounts<RE::TESBoundObject>& a_items, std::span<const PlannedLeveledItem> a_leveledItems) {
+				collected += a_items.size() + a_leveledItems.size();
+				inlined = inlined && a_items.IsInline();
+			};
+
+			// The first pass sizes per-thread scratch buffers and lazily computed data of the NPC.
+			for_each_form<RE::TESBoundObject>(npcData, entries, input, collect);
+
+			const auto allocations = ::Testing::Allocations::Get();
+			const auto time = ::Testing::Benchmark::Measure([&] {
+				for (std::size_t round = 0; round < rounds; ++round) {
+					for_each_form<RE::TESBoundObject>(npcData, entries, input, collect);
+				}
+			});
+			const auto madeAllocations = ::Testing::Allocations::Get() - allocations;
+
+			::Testing::Benchmark::Report("Item collection ({} entries): {:.2f}μs and {} allocations per NPC", entries.size(), static_cast<double>(time) / rounds, static_cast<double>(madeAllocations) / rounds);
+
+			ASSERT(collected > 0, "Expected items to be collected");
+			ASSERT(inlined, "Expected collected items to stay inline");
+			EXPECT(madeAllocations == 0, fmt::format("Expected collecting items not to allocate, but it made {} allocations", madeAllocations));
+		}
+
+		TEST(LinkedForms_FlatTableMatchesNestedMaps)
+		{
+			constexpr std::uint32_t parentCount = 500;
+			constexpr std::uint32_t pathCount = 8;
+			constexpr std::uint32_t linksPerParent = 4;
+			constexpr std::size_t   rounds = 100;
+
+			const auto dataHandler = RE::TESDataHandler::GetSingleton();
+
+			std::vector<RE::SpellItem*> spells{};
+			for (const auto spell : dataHandler->GetFormArray<RE::SpellItem>()) {
+				if (spell && spell->GetFile(0)) {
+					spells.push_back(spell);
+				}
+			}
+			ASSERT(spells.size() >= parentCount * (linksPerParent + 2), "Expected enough spells to link");
+
+			const auto raw_form = [](const RE::TESForm* a_form) {
+				return fmt::format("0x{:X}~{}", a_form->GetLocalFormID(), a_form->GetFile(0)->GetFilename());
+			};
+
+			// Synthetic link graph: each parent has a few spells linked in one of the configs and a spell linked globally.
+			struct Link
+			{
+				RE::SpellItem* form;
+				RE::TESForm*   parent;
+				Paths::ID      path;
+			};
+
+			std::vector<Link>            links{};
+			std::vector<DistributedForm> parents{};
+			auto                         next = parentCount;
+			for (std::uint32_t i = 0; i < parentCount; ++i) {
+				const auto  parent = spells[i];
+				const Path  path = fmt::format("Test_Linked{}_DISTR.ini", i % pathCount);
+				const auto  pathID = Paths::Intern(path);
+				for (std::uint32_t j = 0; j < linksPerParent; ++j) {
+					const auto form = spells[next++];
+					LinkedDistribution::INI::TryParse("LinkedSpell", fmt::format("{}|{}", raw_form(form), raw_form(parent)), path);
+					links.push_back({ form, parent, pathID });
+				}
+				const auto form = spells[next++];
+				LinkedDistribution::INI::TryParse("GlobalLinkedSpell", fmt::format("{}|{}", raw_form(form), raw_form(parent)), path);
+				links.push_back({ form, parent, Paths::none });
+
+				parents.push_back({ parent, pathID });
+			}
+
+			auto manager = std::make_unique<LinkedDistribution::Manager>();
+			manager->LookupLinkedForms(dataHandler);
+
+			// The layout that linked forms were stored in before: nested node-based maps for each of 11 form types.
+			using LegacyFormsMap = std::unordered_map<LinkedDistribution::DistributionType, std::unordered_map<Paths::ID, std::unordered_map<RE::TESForm*, Forms::DataVec<RE::SpellItem>>>>;
+
+			auto legacy = std::make_unique<std::array<LegacyFormsMap, LinkedDistribution::LinkedSet::typeCount>>();
+			for (const auto& [form, parent, path] : links) {
+				(*legacy)[0][LinkedDistribution::kRegular][path][parent].emplace_back(0, false, form, RandomCount(1, 1), FilterData({}, {}, {}, {}, 100), path);
+			}
+
+			const auto legacy_find = [&](const LegacyFormsMap& a_forms, Paths::ID a_path, RE::TESForm* a_parent) -> std::size_t {
+				if (const auto typeIt = a_forms.find(LinkedDistribution::kRegular); typeIt != a_forms.end()) {
+					if (const auto pathIt = typeIt->second.find(a_path); pathIt != typeIt->second.end()) {
+						if (const auto formIt = pathIt->second.find(a_parent); formIt != pathIt->second.end()) {
+							return formIt->second.size();
+						}
+					}
+				}
+				return 0;
+			};
+
+			std::size_t legacyEntries = 0;
+			const auto  legacyTime = ::Testing::Benchmark::Measure([&] {
+				for (std::size_t round = 0; round < rounds; ++round) {
+					for (const auto& parent : parents) {
+						for (const auto& forms : *legacy) {
+							legacyEntries += legacy_find(forms, parent.path, parent.form);
+							legacyEntries += legacy_find(forms, Paths::none, parent.form);
+						}
+					}
+				}
+			});
+
+			std::size_t flatEntries = 0;
+			const auto  flatTime = ::Testing::Benchmark::Measure([&] {
+				for (std::size_t round = 0; round < rounds; ++round) {
+					for (const auto& parent : parents) {
+						DistributedForms forms{};
+						forms.insert(parent);
+						manager->ForEachLinkedDistributionSet(LinkedDistribution::kRegular, forms, [&](DistributionSet& a_set) { flatEntries += a_set.spells.size(); });
+					}
+				}
+			});
+
+			// Memory that each layout keeps is measured as bytes that are freed when it's destroyed.
+			auto bytes = ::Testing::Allocations::GetBytes();
+			legacy.reset();
+			const auto legacyBytes = bytes - ::Testing::Allocations::GetBytes();
+
+			bytes = ::Testing::Allocations::GetBytes();
+			manager.reset();
+			const auto flatBytes = bytes - ::Testing::Allocations::GetBytes();
+
+			const auto per_parent = [&](auto a_time) { return static_cast<double>(a_time) * 1000 / (rounds * parents.size()); };
+			::Testing::Benchmark::Report("Linked forms ({} links of {} parents): {:.0f}ns and {}KB with nested maps, {:.0f}ns and {}KB with the flat table", links.size(), parents.size(), per_parent(legacyTime), legacyBytes / 1024, per_parent(flatTime), flatBytes / 1024);
+
+			EXPECT(flatEntries == legacyEntries, fmt::format("Expected both layouts to find the same linked forms, but got {} and {}", flatEntries, legacyEntries));
+		}
+
+		TEST(LevelChange_EvaluatesOnlyCrossedBoundaries)
+		{
+			constexpr std::uint32_t entryCount = 500;
+			constexpr std::uint32_t actorCount = 100;
+			constexpr std::uint16_t maxPlayerLevel = 81;
+
+			const auto& spells = RE::TESDataHandler::GetSingleton()->GetFormArray<RE::SpellItem>();
+			ASSERT(spells.size() >= entryCount, "Expected enough spells to distribute");
+
+			const auto actor = ::Testing::Helper::Actor::GetActor();
+			NPCData    npcData{ actor };
+
+			// Synthetic leveled entries: most of them require a range of levels, some also require a skill.
+			std::mt19937                                 rng{ ::Testing::Helper::seed };
+			std::uniform_int_distribution<std::uint16_t> level{ 1, 80 };
+			std::uniform_int_distribution<std::uint16_t> span{ 0, 30 };
+			std::uniform_int_distribution<>              percent{ 0, 99 };
+
+			Forms::Distributables<RE::SpellItem> distributable{ RECORD::kSpell };
+			for (std::uint32_t i = 0; i < entryCount; ++i) {
+				LevelFilters levels{};
+				const auto   min = level(rng);
+				levels.actorLevel = percent(rng) < 30 ? Range<std::uint16_t>(min) : Range<std::uint16_t>(min, static_cast<std::uint16_t>(min + span(rng)));
+				if (percent(rng) < 5) {
+					levels.skillLevels.push_back({ 0, Range<std::uint8_t>(50) });
+				}
+				distributable.EmplaceForm(true, spells[i], false, RandomCount(1, 1), FilterData{ {}, {}, levels, {}, 100 }, Path{ "" });
+			}
+			distributable.FinishLookupForms();
+
+			auto& leveled = distributable.GetForms(true);
+			ASSERT(leveled.size() == entryCount, "Expected all entries to be leveled");
+
+			// Synthetic actors that level with the player: level is player's level scaled by a multiplier and clamped to actor's limits.
+			struct LeveledActor
+			{
+				float         mult;
+				std::uint16_t min;
+				std::uint16_t max;
+
+				[[nodiscard]] std::uint16_t GetLevel(std::uint16_t a_playerLevel) const
+				{
+					return std::clamp(static_cast<std::uint16_t>(std::max(1.0f, a_playerLevel * mult)), min, max);
+				}
+			};
+
+			std::uniform_real_distribution<float> mult{ 0.5f, 2.0f };
+			std::vector<LeveledActor>             actors{};
+			for (std::uint32_t i = 0; i < actorCount; ++i) {
+				const auto min = static_cast<std::uint16_t>(1 + percent(rng) % 10);
+				actors.push_back({ mult(rng), min, static_cast<std::uint16_t>(min + 10 + percent(rng)) });
+			}
+
+			// Entries that are skipped must have the same Actor Level verdict and no Skill Level filters.
+			for (std::uint16_t playerLevel = 1; playerLevel < maxPlayerLevel; ++playerLevel) {
+				for (const auto& leveledActor : actors) {
+					const auto oldLevel = leveledActor.GetLevel(playerLevel);
+					const auto newLevel = leveledActor.GetLevel(playerLevel + 1);
+
+					Set<std::uint32_t> changed{};
+					for (const auto& formData : distributable.GetForms(oldLevel, newLevel)) {
+						changed.insert(formData.index);
+					}
+					for (const auto& formData : leveled) {
+						if (!changed.contains(formData.index)) {
+							const auto& [actorLevel, skillLevels, _] = formData.filters.levels;
+							ASSERT(skillLevels.empty() && actorLevel.IsInRange(oldLevel) == actorLevel.IsInRange(newLevel), fmt::format("Expected entry {} to be evaluated when level changes from {} to {}", formData.index, oldLevel, newLevel));
+						}
+					}
+				}
+			}
+
+			// Verdicts are accumulated, so that evaluation isn't optimized away.
+			std::size_t passed = 0;
+
+			const auto simulate = [&](auto&& a_getEntries) {
+				std::size_t evaluated = 0;
+
+				const auto time = ::Testing::Benchmark::Measure([&] {
+					for (std::uint16_t playerLevel = 1; playerLevel < maxPlayerLevel; ++playerLevel) {
+						for (const auto& leveledActor : actors) {
+							for (const auto& formData : a_getEntries(leveledActor.GetLevel(playerLevel), leveledActor.GetLevel(playerLevel + 1))) {
+								++evaluated;
+								passed += detail::passed_filters(npcData, formData);
+							}
+						}
+					}
+				});
+
+				return std::pair{ time, evaluated };
+			};
+
+			const auto [fullTime, fullEvaluated] = simulate([&](std::uint16_t, std::uint16_t) -> Forms::DataVec<RE::SpellItem>& { return leveled; });
+			const auto [deltaTime, deltaEvaluated] = simulate([&](std::uint16_t a_old, std::uint16_t a_new) -> Forms::DataVec<RE::SpellItem>& { return distributable.GetForms(a_old, a_new); });
+
+			::Testing::Benchmark::Report("Level changes 1-{} ({} actors x {} entries): {}μs and {} evaluations for all entries, {}μs and {} evaluations for crossed boundaries ({} passed)", maxPlayerLevel, actorCount, entryCount, fullTime, fullEvaluated, deltaTime, deltaEvaluated, passed);
+
+			EXPECT(deltaEvaluated < fullEvaluated, "Expected level changes to evaluate fewer entries than full distribution");
+		}
+
+		TEST(LevelChange_PlansEntriesThatNeedCrossedForms)
+		{
+			const auto actor = ::Testing::Helper::Actor::GetActor();
+			NPCData    npcData{ actor };
+
+			const auto input = PCLevelMult::Input{ actor, npcData.GetNPC(), true };
+			ASSERT(input.npcLevel > 1, "Expected NPC to be above the first level");
+
+			const auto dataHandler = RE::TESDataHandler::GetSingleton();
+
+			RE::TESFaction* faction = nullptr;
+			for (const auto candidate : dataHandler->GetFormArray<RE::TESFaction>()) {
+				if (candidate && !npcData.HasMember(candidate)) {
+					faction = candidate;
+					break;
+				}
+			}
+			RE::SpellItem* spell = nullptr;
+			for (const auto candidate : dataHandler->GetFormArray<RE::SpellItem>()) {
+				if (candidate && !npcData.HasMember(candidate)) {
+					spell = candidate;
+					break;
+				}
+			}
+			ASSERT(faction && spell, "Expected a faction and a spell that NPC doesn't have");
+
+			// The faction's entry starts passing at NPC's level, while the spell's entry passed long before, but requires the faction.
+			LevelFilters crossedLevels{};
+			crossedLevels.actorLevel = Range<std::uint16_t>(input.npcLevel);
+			::Testing::Helper::Distribution::GetFactions().EmplaceForm(true, faction, false, RandomCount(1, 1), FilterData{ {}, {}, crossedLevels, {}, 100 }, Path{ "" });
+
+			LevelFilters earlierLevels{};
+			earlierLevels.actorLevel = Range<std::uint16_t>(1);
+			FormFilters requiredFaction{};
+			requiredFaction.ALL.push_back(faction);
+			::Testing::Helper::Distribution::GetSpells().EmplaceForm(true, spell, false, RandomCount(1, 1), FilterData{ {}, requiredFaction, earlierLevels, {}, 100 }, Path{ "" });
+
+			::Testing::Helper::Distribution::GetFactions().FinishLookupForms();
+			::Testing::Helper::Distribution::GetSpells().FinishLookupForms();
+
+			DistributionPlan plan{};
+			PlanLevelChange(npcData, input, static_cast<std::uint16_t>(input.npcLevel - 1), plan);
+
+			// Neither the probe of crossed entries nor the plan itself were applied, so entries must not have counted the NPC.
+			const auto crossedCount = ::Testing::Helper::Distribution::GetFactions().GetForms(static_cast<std::uint16_t>(input.npcLevel - 1), input.npcLevel).front().npcCount;
+			const auto plannedCount = ::Testing::Helper::Distribution::GetFactions().GetForms(true).front().npcCount;
+
+			::Testing::Helper::Distribution::ClearConfigs();
+			::Testing::Helper::Distribution::GetFactions().FinishLookupForms();
+			::Testing::Helper::Distribution::GetSpells().FinishLookupForms();
+
+			ASSERT(std::ranges::find(plan.factions, faction) != plan.factions.end(), "Expected the crossed faction entry to be planned");
+			ASSERT(std::ranges::find(plan.spells, spell) != plan.spells.end(), "Expected the spell entry that requires the crossed faction to be planned as well");
+			EXPECT(crossedCount == 0 && plannedCount == 0, fmt::format("Expected planning not to count NPCs of entries, but they counted {} and {}", crossedCount, plannedCount));
+		}
+
+		TEST(PCLevelMult_CompactCacheMemory)
+		{
+			constexpr std::uint32_t actorCount = 10000;
+			constexpr std::uint16_t levelCount = 50;
+			constexpr std::uint32_t entryCount = 1000;
+
+			const auto& spells = RE::TESDataHandler::GetSingleton()->GetFormArray<RE::SpellItem>();
+			ASSERT(spells.size() >= entryCount, "Expected enough spells to distribute");
+
+			const auto actor = ::Testing::Helper::Actor::GetActor();
+			auto       input = PCLevelMult::Input{ actor, actor->GetActorBase(), true };
+
+			// The layout that the cache had before: nested maps for players, NPCs, levels, forms and entries.
+			struct LegacyData
+			{
+				struct Entries
+				{
+					Map<RE::FormID, Set<std::uint32_t>> rejectedEntries{};
+					Map<RE::FormType, Set<RE::FormID>>  distributedEntries{};
+				};
+
+				Map<std::uint16_t, Entries> entries{};
+			};
+
+			using LegacyCache = Map<std::uint64_t, Map<RE::FormID, LegacyData>>;
+
+			auto legacy = std::make_unique<LegacyCache>();
+			auto manager = std::make_unique<PCLevelMult::Manager>();
+
+			// Synthetic leveled actors that fail a chance roll at some levels and receive a form at others.
+			std::mt19937                                 rng{ ::Testing::Helper::seed };
+			std::uniform_int_distribution<std::uint32_t> entry{ 0, entryCount - 1 };
+			std::uniform_int_distribution<>              percent{ 0, 99 };
+
+			struct Rejection
+			{
+				RE::FormID    npcFormID;
+				RE::FormID    formID;
+				std::uint32_t index;
+			};
+
+			std::vector<Rejection> rejections{};
+			std::size_t            distributions = 0;
+
+			for (std::uint32_t i = 0; i < actorCount; ++i) {
+				input.npcFormID = 0xFF000000 + i;
+				for (std::uint16_t level = 1; level <= levelCount; ++level) {
+					input.npcLevel = level;
+					if (percent(rng) < 20) {
+						const auto index = entry(rng);
+						const auto formID = spells[index]->GetFormID();
+						(*legacy)[input.playerID][input.npcFormID].entries[level].rejectedEntries[formID].insert(index);
+						manager->InsertRejectedEntry(input, formID, index);
+						rejections.push_back({ input.npcFormID, formID, index });
+					}
+					if (percent(rng) < 10) {
+						const Set<RE::FormID> formIDs{ spells[entry(rng)]->GetFormID() };
+						(*legacy)[input.playerID][input.npcFormID].entries[level].distributedEntries[RE::FormType::Spell].insert(formIDs.begin(), formIDs.end());
+						manager->InsertDistributedEntry(input, RE::FormType::Spell, formIDs);
+						++distributions;
+					}
+				}
+			}
+
+			input.npcLevel = levelCount;
+			for (const auto& [npcFormID, formID, index] : rejections) {
+				input.npcFormID = npcFormID;
+				ASSERT(manager->FindRejectedEntry(input, formID, index), fmt::format("Expected entry {} of [{:X}] to be rejected for [{:X}]", index, formID, npcFormID));
+			}
+
+			std::size_t legacyForms = 0;
+			std::size_t compactForms = 0;
+			for (std::uint32_t i = 0; i < actorCount; ++i) {
+				input.npcFormID = 0xFF000000 + i;
+				Set<RE::FormID> formIDs{};
+				for (const auto& [level, entries] : (*legacy)[input.playerID][input.npcFormID].entries) {
+					for (const auto& [formType, distributed] : entries.distributedEntries) {
+						formIDs.insert(distributed.begin(), distributed.end());
+					}
+				}
+				legacyForms += formIDs.size();
+				manager->ForEachDistributedEntry(input, true, [&](RE::FormType, std::span<const RE::FormID> a_formIDs) { compactForms += a_formIDs.size(); });
+			}
+			ASSERT(legacyForms == compactForms, fmt::format("Expected both layouts to report the same distributed forms, but got {} and {}", legacyForms, compactForms));
+
+			// Memory that each layout keeps is measured as bytes that are freed when it's destroyed.
+			auto bytes = ::Testing::Allocations::GetBytes();
+			legacy.reset();
+			const auto legacyBytes = bytes - ::Testing::Allocations::GetBytes();
+
+			bytes = ::Testing::Allocations::GetBytes();
+			manager.reset();
+			const auto compactBytes = bytes - ::Testing::Allocations::GetBytes();
+
+			::Testing::Benchmark::Report("PCLevelMult cache ({} actors x {} levels, {} rejections, {} distributions): {}KB with nested maps, {}KB with flat storage", actorCount, levelCount, rejections.size(), distributions, legacyBytes / 1024, compactBytes / 1024);
+
+			EXPECT(compactBytes < legacyBytes, "Expected flat storage to take less memory than nested maps");
+		}
 	}
 }
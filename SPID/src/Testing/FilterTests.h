@@ -0,0 +1,644 @@
+#pragma once
+#include "AhoCorasick.h"
+#include "Atoms.h"
+#include "CaseFold.h"
+#include "FormData.h"
+#include "FormLists.h"
+#include "LookupNPC.h"
+#include "Random.h"
+#include "Testing.h"
+#include "TestsHelpers.h"
+
+namespace Filter
+{
+	namespace Testing
+	{
+		constexpr static const char* moduleName = "Filters";
+
+		namespace detail
+		{
+			/// Randomly changes case of each character in the string.
+			inline std::string random_case(std::string a_str, std::mt19937& a_rng)
+			{
+				std::bernoulli_distribution upper{ 0.5 };
+				for (auto& ch : a_str) {
+					ch = static_cast<char>(upper(a_rng) ? std::toupper(static_cast<unsigned char>(ch)) : std::tolower(static_cast<unsigned char>(ch)));
+				}
+				return a_str;
+			}
+
+			inline StringVec make_vocabulary(std::size_t a_size, std::mt19937& a_rng)
+			{
+				static constexpr std::string_view prefixes[] = { "ActorType", "Vampire", "Creature", "Race", "Magic", "Armor", "Weap", "Loc" };
+				std::uniform_int_distribution<std::size_t> prefix{ 0, std::size(prefixes) - 1 };
+
+				StringVec vocabulary{};
+				vocabulary.reserve(a_size);
+				for (std::size_t i = 0; i < a_size; ++i) {
+					vocabulary.push_back(fmt::format("{}{}", prefixes[prefix(a_rng)], i));
+				}
+				return vocabulary;
+			}
+
+			inline StringVec sample(const StringVec& a_vocabulary, std::size_t a_count, std::mt19937& a_rng)
+			{
+				std::uniform_int_distribution<std::size_t> index{ 0, a_vocabulary.size() - 1 };
+
+				StringVec result{};
+				result.reserve(a_count);
+				for (std::size_t i = 0; i < a_count; ++i) {
+					result.push_back(random_case(a_vocabulary[index(a_rng)], a_rng));
+				}
+				return result;
+			}
+
+			/// Generates a string of random ASCII characters (including those next to letters) and UTF-8 sequences.
+			inline std::string random_text(std::size_t a_size, std::mt19937& a_rng)
+			{
+				static constexpr std::string_view pieces[] = { "a", "Z", "m", "Q", "@", "[", "`", "{", "_", "0", "\xC3\x84", "\xC3\xA4", "\xD0\x96", "\xE2\x82\xAC" };
+				std::uniform_int_distribution<std::size_t> piece{ 0, std::size(pieces) - 1 };
+
+				std::string result{};
+				while (result.size() < a_size) {
+					result += pieces[piece(a_rng)];
+				}
+				return result;
+			}
+
+			/// Generates filters with random level, skill and trait requirements.
+			inline std::vector<FilterData> random_filters(std::size_t a_count, std::mt19937& a_rng)
+			{
+				std::uniform_int_distribution<std::uint32_t> skill{ 0, NPC::Features::skillCount - 1 };
+				std::uniform_int_distribution<std::uint32_t> level{ 0, 100 };
+				std::uniform_int_distribution<int>           coin{ 0, 2 };
+
+				const auto random_range = [&]<typename T>(T a_max) {
+					auto min = static_cast<T>(level(a_rng) % a_max);
+					auto max = static_cast<T>(min + level(a_rng));
+					return coin(a_rng) ? Range<T>(min, max) : Range<T>(min);
+				};
+
+				const auto random_trait = [&]() -> std::optional<bool> {
+					switch (coin(a_rng)) {
+					case 0:
+						return false;
+					case 1:
+						return true;
+					default:
+						return std::nullopt;
+					}
+				};
+
+				std::vector<FilterData> filters{};
+				filters.reserve(a_count);
+				for (std::size_t i = 0; i < a_count; ++i) {
+					LevelFilters levels{};
+					if (coin(a_rng)) {
+						levels.actorLevel = random_range(std::uint16_t{ 80 });
+					}
+					for (auto n = coin(a_rng); n > 0; --n) {
+						levels.skillLevels.push_back({ skill(a_rng), random_range(std::uint8_t{ 100 }) });
+					}
+					for (auto n = coin(a_rng); n > 0; --n) {
+						levels.skillWeights.push_back({ skill(a_rng), random_range(std::uint8_t{ 3 }) });
+					}
+
+					Traits traits{};
+					if (const auto female = random_trait()) {
+						traits.sex = *female ? RE::SEX::kFemale : RE::SEX::kMale;
+					}
+					traits.unique = random_trait();
+					traits.summonable = random_trait();
+					traits.child = random_trait();
+					traits.leveled = random_trait();
+					traits.teammate = random_trait();
+					traits.startsDead = random_trait();
+
+					filters.emplace_back(StringFilters{}, FormFilters{}, levels, traits, 100);
+				}
+				return filters;
+			}
+
+			/// Generates Features of a random NPC.
+			inline NPC::Features random_features(std::mt19937& a_rng)
+			{
+				std::uniform_int_distribution<std::uint32_t> value{ 0, 100 };
+				std::uniform_int_distribution<std::uint32_t> weight{ 0, 3 };
+				std::uniform_int_distribution<std::uint32_t> traits{ 0, NPC::kNever - 1 };
+
+				NPC::Features features{};
+				for (std::size_t skill = 0; skill < NPC::Features::skillCount; ++skill) {
+					features.skills[skill] = static_cast<std::uint8_t>(value(a_rng));
+					features.skillWeights[skill] = static_cast<std::uint8_t>(weight(a_rng));
+				}
+				features.level = static_cast<std::uint16_t>(value(a_rng));
+				features.traits = static_cast<std::uint8_t>(traits(a_rng));
+				features.hasClass = value(a_rng) % 4 != 0;
+				return features;
+			}
+
+			/// Returns data of all NPCs that are currently loaded.
+			inline std::vector<NPCData> loaded_npcs()
+			{
+				std::vector<NPCData> npcs{};
+				for (const auto actor : ::Testing::Helper::Actor::GetLoaded()) {
+					npcs.emplace_back(actor);
+				}
+				return npcs;
+			}
+
+			/// Reference implementation of HasStringFilter that compares strings directly.
+			inline bool has_string_filter(const StringVec& a_npcStrings, const StringVec& a_filter, bool a_all)
+			{
+				const auto has_string = [&](const std::string& str) {
+					return std::ranges::any_of(a_npcStrings, [&](const auto& npcStr) { return string::iequals(npcStr, str); });
+				};
+				return a_all ? std::ranges::all_of(a_filter, has_string) : std::ranges::any_of(a_filter, has_string);
+			}
+		}
+
+		TEST(Atoms_AreCaseInsensitive)
+		{
+			Atoms::Table table{};
+
+			const auto atom = table.Intern("ActorTypeNPC");
+
+			ASSERT(table.Intern("actortypenpc") == atom, "Expected differently cased strings to share an Atom");
+			ASSERT(table.Intern("ActorTypeCreature") != atom, "Expected different strings to have different Atoms");
+			ASSERT(table.Find("ACTORTYPENPC") == atom, "Expected to find an interned string regardless of case");
+			ASSERT(!table.Find("ActorTypeDragon"), "Expected not to find a string that wasn't interned");
+			EXPECT(table.GetString(atom) == "actortypenpc", fmt::format("Expected Atom to be represented by a case-folded string, but got {}", table.GetString(atom)));
+		}
+
+		TEST(Atoms_StringFiltersMatchReference)
+		{
+			constexpr std::size_t vocabularySize = 2000;
+			constexpr std::size_t npcCount = 1000;
+			constexpr std::size_t filterCount = 200;
+
+			std::mt19937 rng{ ::Testing::Helper::seed };
+
+			Atoms::Table table{};
+
+			const auto vocabulary = detail::make_vocabulary(vocabularySize, rng);
+
+			std::vector<StringVec> filters{};
+			std::vector<AtomVec>   filterAtoms{};
+			for (std::size_t i = 0; i < filterCount; ++i) {
+				auto& filter = filters.emplace_back(detail::sample(vocabulary, 1 + i % 4, rng));
+
+				AtomVec atoms{};
+				for (const auto& str : filter) {
+					atoms.push_back(table.Intern(str));
+				}
+				filterAtoms.push_back(std::move(atoms));
+			}
+
+			std::vector<StringVec>  npcStrings{};
+			std::vector<Atoms::Set> npcAtoms{};
+			for (std::size_t i = 0; i < npcCount; ++i) {
+				auto& strings = npcStrings.emplace_back(detail::sample(vocabulary, 20, rng));
+
+				Atoms::Set atoms{};
+				for (const auto& str : strings) {
+					// Same as NPC::Data, strings that were never interned are not tracked.
+					if (const auto atom = table.Find(str)) {
+						atoms.insert(*atom);
+					}
+				}
+				npcAtoms.push_back(std::move(atoms));
+			}
+
+			std::vector<bool> expected{};
+			std::vector<bool> actual{};
+			expected.reserve(npcCount * filterCount * 2);
+			actual.reserve(npcCount * filterCount * 2);
+
+			const auto referenceTime = ::Testing::Benchmark::Measure([&] {
+				for (std::size_t n = 0; n < npcCount; ++n) {
+					for (const auto& filter : filters) {
+						expected.push_back(detail::has_string_filter(npcStrings[n], filter, false));
+						expected.push_back(detail::has_string_filter(npcStrings[n], filter, true));
+					}
+				}
+			});
+
+			const auto atomsTime = ::Testing::Benchmark::Measure([&] {
+				for (std::size_t n = 0; n < npcCount; ++n) {
+					for (const auto& atoms : filterAtoms) {
+						actual.push_back(npcAtoms[n].contains_any(atoms));
+						actual.push_back(npcAtoms[n].contains_all(atoms));
+					}
+				}
+			});
+
+			::Testing::Benchmark::Report("String filters: {}μs with strings, {}μs with atoms", referenceTime, atomsTime);
+
+			EXPECT(expected == actual, "Expected atom-based string filters to match string comparisons");
+		}
+
+		TEST(AhoCorasick_MatchesReference)
+		{
+			constexpr std::size_t vocabularySize = 2000;
+			constexpr std::size_t patternCount = 300;
+			constexpr std::size_t textCount = 5000;
+
+			std::mt19937 rng{ ::Testing::Helper::seed };
+
+			const auto vocabulary = detail::make_vocabulary(vocabularySize, rng);
+
+			// Partial filters are random substrings of real strings, so that they actually match something.
+			StringVec patterns{};
+			for (const auto& str : detail::sample(vocabulary, patternCount, rng)) {
+				std::uniform_int_distribution<std::size_t> start{ 0, str.size() - 1 };
+
+				const auto pos = start(rng);
+				std::uniform_int_distribution<std::size_t> length{ 1, std::min<std::size_t>(str.size() - pos, 8) };
+				patterns.push_back(str.substr(pos, length(rng)));
+			}
+			patterns.emplace_back();  // empty patterns never match.
+
+			const auto texts = detail::sample(vocabulary, textCount, rng);
+
+			std::vector<bool> expected{};
+			std::vector<bool> actual(textCount * patterns.size(), false);
+			expected.reserve(textCount * patterns.size());
+
+			const auto referenceTime = ::Testing::Benchmark::Measure([&] {
+				for (const auto& text : texts) {
+					for (const auto& pattern : patterns) {
+						expected.push_back(string::icontains(text, pattern));
+					}
+				}
+			});
+
+			// The automaton is built once when configs are read, so only matching is measured.
+			const AhoCorasick automaton{ patterns };
+			const auto        automatonTime = ::Testing::Benchmark::Measure([&] {
+				for (std::size_t t = 0; t < texts.size(); ++t) {
+					automaton.ForEachMatch(texts[t], [&](const auto pattern) { actual[t * patterns.size() + pattern] = true; });
+				}
+			});
+
+			::Testing::Benchmark::Report("Partial string filters: {}μs with icontains, {}μs with automaton ({} states)", referenceTime, automatonTime, automaton.size());
+
+			EXPECT(expected == actual, "Expected automaton to match the same patterns as icontains");
+		}
+
+		TEST(CaseFold_MatchesStringFunctions)
+		{
+			// Substring matching has no CaseFold kernel: partial String Filters are matched by the automaton, see AhoCorasick_MatchesReference.
+			constexpr std::size_t textCount = 20000;
+
+			std::mt19937 rng{ ::Testing::Helper::seed };
+
+			std::uniform_int_distribution<std::size_t> textSize{ 0, 80 };
+			std::bernoulli_distribution                altered{ 0.5 };
+
+			std::vector<std::pair<std::string, std::string>> pairs{};
+			pairs.reserve(textCount);
+			for (std::size_t i = 0; i < textCount; ++i) {
+				auto text = detail::random_text(textSize(rng), rng);
+				// Other strings differ from texts in case, and half of them in one more character, so that both outcomes are well represented.
+				auto other = detail::random_case(text, rng);
+				if (altered(rng) && !other.empty()) {
+					std::uniform_int_distribution<std::size_t> pos{ 0, other.size() - 1 };
+					auto&                                      ch = other[pos(rng)];
+					ch = ch == '#' ? '$' : '#';
+				}
+				pairs.emplace_back(std::move(text), std::move(other));
+			}
+
+			std::vector<bool> expected{};
+			std::vector<bool> actual{};
+			expected.reserve(textCount);
+			actual.reserve(textCount);
+
+			const auto referenceTime = ::Testing::Benchmark::Measure([&] {
+				for (const auto& [text, other] : pairs) {
+					expected.push_back(string::iequals(text, other));
+				}
+			});
+
+			const auto caseFoldTime = ::Testing::Benchmark::Measure([&] {
+				for (const auto& [text, other] : pairs) {
+					actual.push_back(CaseFold::iequals(text, other));
+				}
+			});
+
+			::Testing::Benchmark::Report("Case-insensitive comparisons: {}μs with string functions, {}μs with CaseFold", referenceTime, caseFoldTime);
+
+			ASSERT(expected == actual, "Expected CaseFold to agree with string::iequals");
+
+			const auto text = detail::random_text(200, rng);
+			auto lower = text;
+			std::ranges::transform(lower, lower.begin(), [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+			ASSERT(CaseFold::folded(text) == lower, "Expected folded string to be the same as lowercased string");
+
+			std::array<char, 256> buffer;
+			EXPECT(CaseFold::folded(text, buffer) == lower, "Expected string folded into a buffer to be the same as lowercased string");
+		}
+
+		TEST(Random_RollsAreReproducible)
+		{
+			constexpr std::uint32_t actorCount = 1000;
+			constexpr std::uint32_t entryCount = 100;
+			constexpr RE::FormID    form = 0x12EB7;
+
+			const auto originalSeed = Random::GetSeed();
+
+			const auto roll_all = [&] {
+				std::vector<double> rolls{};
+				rolls.reserve(actorCount * entryCount);
+				for (std::uint32_t actor = 0; actor < actorCount; ++actor) {
+					for (std::uint32_t entry = 0; entry < entryCount; ++entry) {
+						rolls.push_back(Random::Stream{ 0xFF000800 + actor, form, entry }.Chance());
+					}
+				}
+				return rolls;
+			};
+
+			double     shared = 0;
+			const auto referenceTime = ::Testing::Benchmark::Measure([&] {
+				for (std::uint32_t i = 0; i < actorCount * entryCount; ++i) {
+					shared += RNG().generate();
+				}
+			});
+
+			Random::SetSeed(::Testing::Helper::seed);
+			std::vector<double> first{};
+			const auto          streamTime = ::Testing::Benchmark::Measure([&] { first = roll_all(); });
+
+			const auto second = roll_all();
+			Random::SetSeed(::Testing::Helper::seed + 1);
+			const auto other = roll_all();
+
+			Random::SetSeed(originalSeed);
+
+			::Testing::Benchmark::Report("Chance rolls: {}μs with shared RNG, {}μs with streams", referenceTime, streamTime);
+
+			ASSERT(first == second, "Expected the same seed to produce the same rolls");
+			ASSERT(first != other, "Expected different seeds to produce different rolls");
+
+			const auto mean = std::accumulate(first.begin(), first.end(), 0.0) / first.size();
+			ASSERT(std::ranges::all_of(first, [](const auto roll) { return roll >= 0 && roll < 1; }), "Expected chance rolls to be in [0, 1)");
+			ASSERT(std::abs(mean - 0.5) < 0.01, fmt::format("Expected chance rolls to be uniform, but their mean is {} (shared RNG: {})", mean, shared / first.size()));
+
+			std::array<std::uint32_t, 5> counts{};
+			for (std::uint32_t entry = 0; entry < entryCount * 10; ++entry) {
+				const auto count = Random::Stream{ 0x14, form, entry }.Count(-2, 2);
+				ASSERT(count >= -2 && count <= 2, fmt::format("Expected count {} to be in [-2, 2]", count));
+				++counts[count + 2];
+			}
+			EXPECT(std::ranges::none_of(counts, [](const auto count) { return count == 0; }), "Expected every count in range to be rolled");
+		}
+
+		TEST(CandidateIndex_ContainsAllMatchingEntries)
+		{
+			const auto actor = ::Testing::Helper::Actor::GetActor();
+			const auto race = actor->GetRace();
+			ASSERT(race, "Expected test actor to have a race");
+
+			NPCData npcData{ actor };
+
+			std::string raceKeyword{};
+			race->ForEachKeyword([&](const RE::BGSKeyword* a_keyword) {
+				raceKeyword = a_keyword->GetFormEditorID();
+				return RE::BSContainer::ForEachResult::kStop;
+			});
+
+			StringFilters keywordMatch{};
+			keywordMatch.MATCH = { raceKeyword };
+
+			StringFilters unknownString{};
+			unknownString.ALL = { "SPID_NonExistentKeyword" };
+
+			const auto oppositeSex = actor->GetActorBase()->GetSex() == RE::SEX::kFemale ? RE::SEX::kMale : RE::SEX::kFemale;
+
+			std::vector<FilterData> filters{
+				{ {}, {}, {}, {}, 100 },                                                        // unconstrained
+				{ {}, { .ALL = { race } }, {}, {}, 100 },                                       // NPC's race
+				{ {}, { .MATCH = { actor->GetActorBase() } }, {}, {}, 100 },                    // NPC itself
+				{ keywordMatch, {}, {}, {}, 100 },                                              // NPC's keyword
+				{ unknownString, {}, {}, {}, 100 },                                             // unknown string
+				{ {}, { .MATCH = { RE::TESForm::LookupByID(0x7) } }, {}, {}, 100 },             // other NPC (Player)
+				{ keywordMatch, { .ALL = { race } }, {}, { .sex = RE::SEX::kFemale }, 100 },  // several requirements
+				{ {}, {}, {}, { .sex = oppositeSex }, 100 }                                  // other sex
+			};
+
+			Forms::DataVec<RE::TESForm> entries{};
+			for (std::uint32_t i = 0; i < filters.size(); ++i) {
+				entries.emplace_back(i, false, race, RandomCount(1, 1), filters[i], Paths::none);
+			}
+			entries.candidates.Build(entries);
+
+			Candidates::Set candidates{};
+			entries.candidates.Collect(npcData, candidates);
+
+			for (std::size_t i = 0; i < entries.size(); ++i) {
+				const bool passed = entries[i].filters.PassedFilters(npcData, { actor->GetFormID(), race->GetFormID(), entries[i].index }) == Result::kPass;
+				const bool isCandidate = candidates.next(i) == i;
+				ASSERT(!passed || isCandidate, fmt::format("Expected entry #{} that passes filters to be a candidate", i));
+			}
+
+			ASSERT(candidates.next(4) != 4 && candidates.next(5) != 5, "Expected entries with unmet requirements not to be candidates");
+			EXPECT(candidates.next(7) != 7, "Expected entry with unmatched traits not to be a candidate");
+		}
+
+		TEST(FormLists_RebuildWhenFormsAreReplaced)
+		{
+			const auto& factions = RE::TESDataHandler::GetSingleton()->GetFormArray<RE::TESFaction>();
+			ASSERT(factions.size() >= 2, "Expected at least two factions");
+
+			const auto factory = RE::IFormFactory::GetConcreteFormFactoryByType<RE::BGSListForm>();
+			const auto list = factory ? factory->Create() : nullptr;
+			ASSERT(list, "Expected a FormList to be created");
+
+			list->forms.push_back(factions[0]);
+			const auto before = FormLists::Manager::GetSingleton()->Get(list);
+
+			// Replacing a form keeps the size of the list, like reverting it and adding another form does.
+			list->forms[0] = factions[1];
+			ASSERT(!before->IsUpToDate(), "Expected the flattened list to be outdated after its form was replaced");
+
+			const auto after = FormLists::Manager::GetSingleton()->Get(list);
+			ASSERT(after->groups.size() == 1, "Expected a single group of factions");
+			EXPECT(FormLists::Flattened::Contains(after->groups[0], factions[1]) && !FormLists::Flattened::Contains(after->groups[0], factions[0]), "Expected the rebuilt list to contain only the new faction");
+		}
+
+		TEST(TraitMask_MatchesTraits)
+		{
+			std::mt19937 rng{ ::Testing::Helper::seed };
+
+			for (const auto& filter : detail::random_filters(500, rng)) {
+				const auto& traits = filter.traits;
+				for (std::uint32_t npcTraits = 0; npcTraits < NPC::kNever; ++npcTraits) {
+					const auto has = [&](NPC::TraitFlags a_flag, const std::optional<bool>& a_value) {
+						return !a_value || ((npcTraits & a_flag) != 0) == *a_value;
+					};
+
+					const bool expected = (!traits.sex || has(NPC::kFemale, *traits.sex == RE::SEX::kFemale)) &&
+					                      has(NPC::kUnique, traits.unique) &&
+					                      has(NPC::kSummonable, traits.summonable) &&
+					                      has(NPC::kChild, traits.child) &&
+					                      has(NPC::kLeveled, traits.leveled) &&
+					                      has(NPC::kTeammate, traits.teammate) &&
+					                      has(NPC::kDead, traits.startsDead);
+
+					ASSERT(filter.traitMask.Matches(static_cast<std::uint8_t>(npcTraits)) == expected, fmt::format("Expected TraitMask to match traits {:#x} the same way as Trait Filters", npcTraits));
+				}
+			}
+		}
+
+		TEST(SkillRanges_MatchSkillFilters)
+		{
+			std::mt19937 rng{ ::Testing::Helper::seed };
+
+			const auto filters = detail::random_filters(500, rng);
+
+			for (std::size_t i = 0; i < 200; ++i) {
+				const auto features = detail::random_features(rng);
+				for (const auto& filter : filters) {
+					const auto in_range = [](const std::vector<SkillLevel>& a_skills, const NPC::Features::Skills& a_values) {
+						return std::ranges::all_of(a_skills, [&](const auto& a_skill) { return a_skill.range.IsInRange(a_values[a_skill.type]); });
+					};
+
+					const auto& levels = filter.levels;
+					ASSERT(Filter::SkillRanges{ levels.skillLevels }.Contains(features.skills) == in_range(levels.skillLevels, features.skills), "Expected SkillRanges of skill levels to match Skill Level filters");
+					ASSERT(Filter::SkillRanges{ levels.skillWeights }.Contains(features.skillWeights) == in_range(levels.skillWeights, features.skillWeights), "Expected SkillRanges of skill weights to match Skill Weight filters");
+				}
+			}
+		}
+
+		TEST(Programs_AreSharedByEqualFilters)
+		{
+			StringFilters strings{};
+			strings.ALL = { "ActorTypeNPC" };
+
+			const FilterData filter{ strings, {}, {}, { .child = false }, 100 };
+			const FilterData sameFilter{ strings, {}, {}, { .child = false }, 50 };
+			const FilterData otherFilter{ strings, {}, {}, { .child = true }, 100 };
+
+			ASSERT(filter.programID == sameFilter.programID, "Expected entries with equal filters and different chance to share a Program");
+			EXPECT(filter.programID != otherFilter.programID, "Expected entries with different filters to have different Programs");
+		}
+
+		TEST(Program_MatchesReference)
+		{
+			std::mt19937 rng{ ::Testing::Helper::seed };
+
+			// Random filters make sure that all instructions are covered, even if configs don't use them.
+			auto filters = detail::random_filters(500, rng);
+			Forms::ForEachDistributable([&]<class Form>(Forms::Distributables<Form>& a_distributable) {
+				for (const auto& formData : a_distributable.GetForms()) {
+					filters.push_back(formData.filters);
+				}
+			});
+
+			const auto npcs = detail::loaded_npcs();
+			ASSERT(!npcs.empty(), "Expected at least one loaded NPC");
+
+			std::vector<bool> expected{};
+			std::vector<bool> actual{};
+			expected.reserve(npcs.size() * filters.size());
+			actual.reserve(npcs.size() * filters.size());
+
+			const auto referenceTime = ::Testing::Benchmark::Measure([&] {
+				for (const auto& npcData : npcs) {
+					for (const auto& filter : filters) {
+						expected.push_back(filter.PassedFiltersReference(npcData) == Result::kPass);
+					}
+				}
+			});
+
+			const auto programTime = ::Testing::Benchmark::Measure([&] {
+				for (const auto& npcData : npcs) {
+					for (const auto& filter : filters) {
+						actual.push_back(filter.program.Evaluate(npcData));
+					}
+				}
+			});
+
+			::Testing::Benchmark::Report("Filters ({} NPCs x {} entries): {}μs with reference, {}μs with programs", npcs.size(), filters.size(), referenceTime, programTime);
+
+			EXPECT(expected == actual, "Expected programs to produce the same results as reference filters");
+		}
+
+		TEST(Program_ReordersInstructionsByProfile)
+		{
+			const auto actor = ::Testing::Helper::Actor::GetActor();
+			NPCData    npcData{ actor };
+
+			// Traits are emitted first, but they never reject this NPC, while the level filter always does.
+			LevelFilters levels{};
+			levels.actorLevel = Range<std::uint16_t>(static_cast<std::uint16_t>(npcData.GetLevel() + 1));
+			const FilterData filter{ {}, {}, levels, { .sex = actor->GetActorBase()->GetSex() }, 100 };
+
+			const auto profile = filter.program.GetProfile();
+			ASSERT(profile && filter.program.GetInstructions().size() == 2, "Expected a profiled program with traits and level instructions");
+
+			for (std::uint32_t i = 0; i < Filter::Profile::samples + 10; ++i) {
+				ASSERT(!filter.program.Evaluate(npcData), "Expected program to produce the same result while being profiled and after that");
+			}
+
+			ASSERT(!profile->IsProfiling(), "Expected profiling to finish after enough samples");
+			EXPECT((profile->GetOrder() & 0xF) == 1, "Expected the level instruction that rejects NPC to be evaluated first");
+		}
+
+#ifdef SPID_FILTER_JIT
+		TEST(JIT_MatchesInterpreter)
+		{
+			constexpr std::size_t featuresCount = 2000;
+
+			std::mt19937 rng{ ::Testing::Helper::seed };
+
+			// Doesn't need loaded NPCs, so that native code can be verified outside of the game.
+			const auto filters = detail::random_filters(2000, rng);
+
+			std::vector<NPC::Features> features{};
+			features.reserve(featuresCount);
+			for (std::size_t i = 0; i < featuresCount; ++i) {
+				features.push_back(detail::random_features(rng));
+			}
+
+			JIT::Compiler compiler{};
+
+			std::vector<std::span<const Instruction>> compiled{};
+			std::vector<JIT::Predicate>               predicates{};
+			for (const auto& filter : filters) {
+				JIT::Predicate predicate{ nullptr };
+				if (const auto count = compiler.Compile(filter.program.GetInstructions(), predicate); count > 0) {
+					compiled.push_back(filter.program.GetInstructions().first(count));
+					predicates.push_back(predicate);
+				}
+			}
+			ASSERT(!predicates.empty(), "Expected at least one Program to be compiled");
+
+			std::vector<bool> expected{};
+			std::vector<bool> actual{};
+			expected.reserve(features.size() * predicates.size());
+			actual.reserve(features.size() * predicates.size());
+
+			const auto interpreterTime = ::Testing::Benchmark::Measure([&] {
+				for (const auto& npcFeatures : features) {
+					for (const auto& instructions : compiled) {
+						expected.push_back(Program::EvaluateFeatures(instructions, npcFeatures));
+					}
+				}
+			});
+
+			const auto nativeTime = ::Testing::Benchmark::Measure([&] {
+				for (const auto& npcFeatures : features) {
+					for (const auto& predicate : predicates) {
+						actual.push_back(predicate(&npcFeatures));
+					}
+				}
+			});
+
+			::Testing::Benchmark::Report("Feature filters ({} NPCs x {} programs): {}μs interpreted, {}μs native ({} bytes)", features.size(), predicates.size(), interpreterTime, nativeTime, compiler.GetSize());
+
+			EXPECT(expected == actual, "Expected native code to produce the same results as the interpreter");
+		}
+#endif
+	}
+}
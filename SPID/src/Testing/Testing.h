@@ -145,6 +145,51 @@ namespace Testing
 
 	inline void Run() { Runner::Run(); }
 
+	/// <summary>
+	/// Counts heap allocations that are made with operator new, and bytes that they keep allocated.
+	///
+	/// Global operator new and delete are replaced in Allocations.cpp to update the counts.
+	/// The counts are kept per thread, so tests can measure allocations of the code they run without noise from other threads.
+	/// </summary>
+	namespace Allocations
+	{
+		inline thread_local std::size_t    count = 0;
+		inline thread_local std::ptrdiff_t bytes = 0;
+
+		/// Returns the number of allocations that the current thread has made so far.
+		inline std::size_t Get() { return count; }
+
+		/// Returns the number of bytes that were allocated by the current thread and are not freed yet.
+		/// Memory is subtracted from the thread that frees it, so measure code that allocates and frees on the same thread.
+		inline std::ptrdiff_t GetBytes() { return bytes; }
+	}
+
+	/// <summary>
+	/// Measures code that tests compare with reference implementations and reports the results.
+	///
+	/// Timings are only reported, tests never assert them, since they depend on the machine and the loaded game.
+	/// </summary>
+	namespace Benchmark
+	{
+		/// Runs a_func once and returns how long it took in microseconds.
+		template <class Func>
+		auto Measure(Func&& a_func)
+		{
+			Timer timer;
+			timer.start();
+			a_func();
+			timer.end();
+			return timer.duration_μs();
+		}
+
+		/// Logs results of a benchmark under the test that is currently running.
+		template <class... Args>
+		void Report(fmt::format_string<Args...> a_fmt, Args&&... a_args)
+		{
+			logger::critical("\t\t{}", fmt::format(a_fmt, std::forward<Args>(a_args)...));
+		}
+	}
+
 	template <typename T>
 	inline T* GetForm(RE::FormID a_formID)
 	{
@@ -1,6 +1,7 @@
 #pragma once
 #include "DeathDistribution.h"
 #include "FormData.h"
+#include "PlanCache.h"
 #include "Testing.h"
 
 namespace DeathDistribution
@@ -23,6 +24,9 @@ namespace DeathDistribution
 
 namespace Testing::Helper
 {
+	/// Seed of randomly generated test data, fixed to make failures reproducible.
+	inline constexpr std::uint32_t seed = 0x5350'4944;
+
 	namespace Actor
 	{
 		inline RE::Actor* GetActor()
@@ -30,6 +34,20 @@ namespace Testing::Helper
 			return GetForm<RE::Actor>(0x198B0);
 		}
 
+		/// Returns all actors that are currently loaded.
+		inline std::vector<RE::Actor*> GetLoaded()
+		{
+			std::vector<RE::Actor*> actors{};
+			if (const auto processLists = RE::ProcessLists::GetSingleton()) {
+				for (const auto& handle : processLists->highActorHandles) {
+					if (const auto actor = handle.get(); actor && actor->GetActorBase()) {
+						actors.push_back(actor.get());
+					}
+				}
+			}
+			return actors;
+		}
+
 		inline RE::Actor* GetAlive()
 		{
 			auto actor = GetActor();
@@ -239,6 +257,8 @@ namespace Testing::Helper::Distribution
 		Forms::skins.GetForms().clear();
 
 		Death::ClearConfigs();
+
+		Distribute::PlanCache::Manager::GetSingleton()->Clear();
 	}
 
 	inline void SnapshotConfigs()
@@ -273,6 +293,8 @@ namespace Testing::Helper::Distribution
 		Forms::skins = configHolder.skins;
 
 		Death::RestoreConfigs();
+
+		Distribute::PlanCache::Manager::GetSingleton()->Clear();
 	}
 }
 #pragma endregion